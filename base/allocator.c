@@ -0,0 +1,48 @@
+#include "allocator.h"
+
+void* arena_allocator_func(void* impl, U8 mode, void* ptr, Size old_size, Size size, Size align){
+	Arena* a = impl;
+	(void)old_size;
+	switch(mode){
+		case AllocatorMode_Alloc:   return arena_alloc(a, size, align);
+		case AllocatorMode_Resize:  return arena_resize(a, ptr, size);
+		case AllocatorMode_Free:    return NULL;
+		case AllocatorMode_FreeAll: arena_free_all(a); return NULL;
+	}
+	return NULL;
+}
+
+void* pool_allocator_func(void* impl, U8 mode, void* ptr, Size old_size, Size size, Size align){
+	Pool* p = impl;
+	(void)old_size;
+	switch(mode){
+		case AllocatorMode_Alloc:
+			if(size > p->slot_size || align > p->slot_align){
+				return NULL;
+			}
+			return pool_alloc(p);
+		case AllocatorMode_Resize:
+			return size <= p->slot_size ? ptr : NULL;
+		case AllocatorMode_Free:
+			pool_free(p, ptr);
+			return NULL;
+		case AllocatorMode_FreeAll:
+			pool_free_all(p);
+			return NULL;
+	}
+	return NULL;
+}
+
+#if defined(TARGET_OS_LINUX) || defined(TARGET_OS_WINDOWS)
+void* heap_allocator_func(void* impl, U8 mode, void* ptr, Size old_size, Size size, Size align){
+	Heap* h = impl;
+	(void)old_size;
+	switch(mode){
+		case AllocatorMode_Alloc:   return heap_alloc(h, size, align);
+		case AllocatorMode_Resize:  return heap_resize(h, ptr, size);
+		case AllocatorMode_Free:    heap_free(h, ptr); return NULL;
+		case AllocatorMode_FreeAll: heap_free_all(h); return NULL;
+	}
+	return NULL;
+}
+#endif
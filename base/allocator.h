@@ -0,0 +1,130 @@
+#ifndef _allocator_h_include_
+#define _allocator_h_include_
+
+#include "base.h"
+#include "memory.h"
+#include "arena.h"
+#include "pool.h"
+#include "heap.h"
+
+typedef struct Allocator Allocator;
+
+typedef enum AllocatorMode AllocatorMode;
+
+enum AllocatorMode {
+	AllocatorMode_Alloc   = 0, // Allocate `size` bytes aligned to `align`
+	AllocatorMode_Resize  = 1, // Resize `ptr` in place to `size`, null on failure
+	AllocatorMode_Free    = 2, // Free `ptr`, `old_size` is a hint
+	AllocatorMode_FreeAll = 3, // Free everything owned by allocator
+};
+
+typedef void* (*AllocatorFunc)(void* impl, U8 mode, void* ptr, Size old_size, Size size, Size align);
+
+// Generic allocator interface, arenas get an inlined fast path
+struct Allocator {
+	AllocatorFunc func;
+	void* data;
+};
+
+void* arena_allocator_func(void* impl, U8 mode, void* ptr, Size old_size, Size size, Size align);
+
+void* pool_allocator_func(void* impl, U8 mode, void* ptr, Size old_size, Size size, Size align);
+
+void* heap_allocator_func(void* impl, U8 mode, void* ptr, Size old_size, Size size, Size align);
+
+static inline
+Allocator arena_allocator(Arena* a){
+	return (Allocator){ .func = arena_allocator_func, .data = a };
+}
+
+// Pool allocator only serves requests that fit in its slots
+static inline
+Allocator pool_allocator(Pool* p){
+	return (Allocator){ .func = pool_allocator_func, .data = p };
+}
+
+static inline
+Allocator heap_allocator(Heap* h){
+	return (Allocator){ .func = heap_allocator_func, .data = h };
+}
+
+// Allocate `size` bytes aligned to `align`, return null on failure
+static inline
+void* mem_alloc(Allocator a, Size size, Size align){
+	if(hint_likely(a.func == arena_allocator_func)){
+		return arena_alloc((Arena*)a.data, size, align);
+	}
+	return a.func(a.data, AllocatorMode_Alloc, NULL, 0, size, align);
+}
+
+// Resize allocation in-place, gives back same pointer on success, null on failure
+static inline
+void* mem_resize(Allocator a, void* ptr, Size old_size, Size new_size){
+	if(hint_likely(a.func == arena_allocator_func)){
+		return arena_resize((Arena*)a.data, ptr, new_size);
+	}
+	return a.func(a.data, AllocatorMode_Resize, ptr, old_size, new_size, 0);
+}
+
+// Free an allocation, this is a no-op for arenas
+static inline
+void mem_free(Allocator a, void* ptr, Size size){
+	if(hint_likely(a.func == arena_allocator_func)){
+		return;
+	}
+	a.func(a.data, AllocatorMode_Free, ptr, size, 0, 0);
+}
+
+// Free all allocations owned by allocator
+static inline
+void mem_free_all(Allocator a){
+	if(hint_likely(a.func == arena_allocator_func)){
+		arena_free_all((Arena*)a.data);
+		return;
+	}
+	a.func(a.data, AllocatorMode_FreeAll, NULL, 0, 0, 0);
+}
+
+// Try to resize allocation in-place, otherwhise re-allocates and frees the old one
+static inline
+void* mem_realloc(Allocator a, void* ptr, Size old_size, Size new_size, Size align){
+	if(hint_likely(a.func == arena_allocator_func)){
+		return arena_realloc((Arena*)a.data, ptr, old_size, new_size, align);
+	}
+	if(ptr == NULL){
+		return mem_alloc(a, new_size, align);
+	}
+	void* new_ptr = mem_resize(a, ptr, old_size, new_size);
+	if(new_ptr == NULL){
+		new_ptr = mem_alloc(a, new_size, align);
+		if(new_ptr != NULL){
+			mem_copy_no_overlap(new_ptr, ptr, min(old_size, new_size));
+			mem_free(a, ptr, old_size);
+		}
+	}
+	return new_ptr;
+}
+
+#if defined(ARENA_STATS)
+static inline
+void* mem_alloc_tracked(Allocator a, Size size, Size align, char const* file, I32 line){
+	if(a.func == arena_allocator_func){
+		return arena_alloc_tracked((Arena*)a.data, size, align, file, line);
+	}
+	return mem_alloc(a, size, align);
+}
+
+static inline
+void* mem_realloc_tracked(Allocator a, void* ptr, Size old_size, Size new_size, Size align, char const* file, I32 line){
+	if(a.func == arena_allocator_func){
+		return arena_realloc_tracked((Arena*)a.data, ptr, old_size, new_size, align, file, line);
+	}
+	return mem_realloc(a, ptr, old_size, new_size, align);
+}
+
+// Attribute arena allocations made through the generic interface to their call site
+#define mem_alloc(A, S, Al) mem_alloc_tracked((A), (S), (Al), __FILE__, __LINE__)
+#define mem_realloc(A, P, Old, New, Al) mem_realloc_tracked((A), (P), (Old), (New), (Al), __FILE__, __LINE__)
+#endif
+
+#endif /* Include guard */
@@ -1,6 +1,9 @@
 #include "arena.h"
 #include "memory.h"
 #include "virtual_memory.h"
+#include "thread.h"
+#include "strings.h"
+#include "trace.h"
 
 bool arena_init_buffer(Arena* a, U8* data, Size len){
 	if(len <= 0){ return false; }
@@ -32,7 +35,135 @@ bool arena_init_virtual(Arena* a, Size reserve){
 	return true;
 }
 
-void *arena_alloc(Arena* a, Size size, Size align){
+#if defined(ARENA_DEBUG)
+// Place the allocation so it ends right before a guard page
+static
+void* arena_alloc_guarded(Arena* a, Size size, Size align){
+	ensure(align <= VIRTUAL_PAGE_SIZE, "Alignment is bigger than a page");
+	Size region = align_forward_size(a->offset, VIRTUAL_PAGE_SIZE);
+	Size pages = align_forward_size(size, VIRTUAL_PAGE_SIZE);
+	if(pages + VIRTUAL_PAGE_SIZE > a->data.reserved - region){
+		return NULL; /* Out of memory */
+	}
+
+	Size end = region + pages + VIRTUAL_PAGE_SIZE;
+	if(end > a->data.commited && virtual_block_push(&a->data, end - a->data.commited) == NULL){
+		return NULL; /* Memory Error */
+	}
+	U8* guard = (U8*)a->data.ptr + region + pages;
+	if(!virtual_protect(guard, VIRTUAL_PAGE_SIZE, 0)){
+		return NULL;
+	}
+
+	void* allocation = (void*)(((Uintptr)guard - size) & ~(Uintptr)(align - 1));
+	a->offset = end;
+	a->last_allocation = (Uintptr)allocation;
+	a->last_guarded = true;
+	ARENA_STAT(
+		a->stats.alloc_count += 1;
+		a->stats.bytes_requested += size;
+		a->stats.peak_offset = max(a->stats.peak_offset, a->offset);
+	);
+	return allocation;
+}
+
+void arena_debug_release(Arena* a, Size offset){
+	if(offset >= a->offset){ return; }
+	U8* base = a->data.ptr;
+	if(a->kind == ArenaKind_Virtual){
+		Size first_page = offset & ~(Size)(VIRTUAL_PAGE_SIZE - 1);
+		virtual_protect(base + first_page, a->offset - first_page, MemoryProtection_Read | MemoryProtection_Write);
+	}
+	mem_set(base + offset, ARENA_POISON_BYTE, a->offset - offset);
+}
+#endif
+
+// Inaccessible page reserved past the end of every chained block
+#if defined(ARENA_DEBUG)
+#define ARENA_BLOCK_GUARD VIRTUAL_PAGE_SIZE
+#else
+#define ARENA_BLOCK_GUARD 0
+#endif
+
+// Map a block of `size` bytes and make it the current one
+static
+bool arena_push_block(Arena* a, Size size){
+	size = align_forward_size(size, VIRTUAL_PAGE_SIZE);
+	ArenaBlock* block = virtual_reserve(size + ARENA_BLOCK_GUARD);
+	if(block == NULL){ return false; }
+	if(a->numa_bound){
+		virtual_bind_node(block, size, a->numa_node);
+	}
+	if(virtual_commit(block, size) == NULL){
+		virtual_free(block, size + ARENA_BLOCK_GUARD);
+		return false;
+	}
+	block->prev = a->data.ptr;
+	block->size = size;
+	a->data = (MemoryBlock){ .ptr = block, .commited = size, .reserved = size };
+	a->offset = sizeof(ArenaBlock);
+	ARENA_STAT(a->stats.commit_count += 1);
+	return true;
+}
+
+// Pop the current block, the previous one is treated as full
+static
+void arena_pop_block(Arena* a){
+	ArenaBlock* block = a->data.ptr;
+	ArenaBlock* prev = block->prev;
+	virtual_free(block, block->size + ARENA_BLOCK_GUARD);
+	a->data = (MemoryBlock){ .ptr = prev, .commited = prev ? prev->size : 0, .reserved = prev ? prev->size : 0 };
+	a->offset = a->data.commited;
+	a->last_allocation = 0;
+}
+
+bool arena_init_chained(Arena* a, Size block_size){
+	mem_set(a, 0, sizeof(*a));
+	a->kind = ArenaKind_Chained;
+	return arena_push_block(a, max(block_size, ARENA_VIRTUAL_BLOCK_SIZE));
+}
+
+bool arena_bind_node(Arena* a, I32 node){
+	if(a->kind == ArenaKind_Buffer){ return false; }
+	if(a->kind == ArenaKind_Chained){
+		for(ArenaBlock* block = a->data.ptr; block != NULL; block = block->prev){
+			if(!virtual_bind_node(block, block->size, node)){ return false; }
+		}
+	}
+	else if(!virtual_bind_node(a->data.ptr, a->data.reserved, node)){
+		return false;
+	}
+	a->numa_bound = true;
+	a->numa_node = node;
+	return true;
+}
+
+void arena_release_blocks(Arena* a, void* block){
+	while(a->data.ptr != block && a->data.ptr != NULL){
+		arena_pop_block(a);
+	}
+}
+
+// Start a new block that can hold `size` bytes aligned to `align`
+static
+bool arena_grow_chain(Arena* a, Size size, Size align){
+	Size next = min(a->data.reserved * 2, (Size)ARENA_CHAINED_MAX_BLOCK);
+	return arena_push_block(a, max(next, (Size)sizeof(ArenaBlock) + size + align));
+}
+
+// Parenthesized names keep the ARENA_STATS tracking macros from expanding here
+
+void *(arena_alloc)(Arena* a, Size size, Size align){
+	#if defined(ARENA_DEBUG)
+	ensure(size >= 0, "Invalid arena allocation size");
+	ensure(mem_valid_alignment(align), "Alignment must be a power of 2");
+	if(a->kind == ArenaKind_Virtual){
+		void* guarded = arena_alloc_guarded(a, size, align);
+		if(guarded != NULL){ return guarded; }
+		/* No room for the guard, fall back to a plain allocation */
+	}
+	a->last_guarded = false;
+	#endif
 	Uintptr base = (Uintptr)a->data.ptr;
 	Uintptr current = (Uintptr)base + (Uintptr)a->offset;
 
@@ -41,15 +172,29 @@ void *arena_alloc(Arena* a, Size size, Size align){
 
 	/* Retry */ while(1){
 		if(hint_unlikely(required > available)){
+			if(a->kind == ArenaKind_Chained){
+				trace_zone("arena_grow_chain");
+				if(!arena_grow_chain(a, size, align)){
+					return NULL; /* Memory Error */
+				}
+				base = (Uintptr)a->data.ptr;
+				current = base + (Uintptr)a->offset;
+				available = a->data.commited - a->offset;
+				required = arena_required_mem(current, size, align);
+				break;
+			}
 			Size in_reserve = a->data.reserved - a->data.commited;
 			Size diff = required - available;
 			if(diff > in_reserve){
 				return NULL; /* Out of memory */
 			}
 			else if(a->kind == ArenaKind_Virtual){
+				trace_zone("arena_commit");
 				if(virtual_block_push(&a->data, required) == NULL){
 					return NULL; /* Memory Error */
 				}
+				trace_counter("arena_commited", a->data.commited);
+				ARENA_STAT(a->stats.commit_count += 1);
 			}
 		}
 
@@ -59,14 +204,82 @@ void *arena_alloc(Arena* a, Size size, Size align){
 	a->offset += required;
 	void* allocation = a->data.ptr + (a->offset - size);
 	a->last_allocation = (Uintptr)allocation;
+
+	ARENA_STAT(
+		a->stats.alloc_count += 1;
+		a->stats.bytes_requested += size;
+		a->stats.bytes_padding += required - size;
+		a->stats.peak_offset = max(a->stats.peak_offset, a->offset);
+	);
 	return allocation;
 }
 
+void arena_set_retention(Arena* a, U8 retention, Size retain, bool eager){
+	a->retention = retention;
+	a->retain = max(retain, (Size)0);
+	a->eager_decommit = eager;
+	a->recent_peak = a->offset;
+}
+
+Size arena_trim(Arena* a, Size keep){
+	if(a->kind != ArenaKind_Virtual){ return 0; }
+	keep = align_forward_size(max(keep, a->offset), VIRTUAL_PAGE_SIZE);
+	if(keep >= a->data.commited){ return 0; }
+
+	Size excess = a->data.commited - keep;
+	if(a->eager_decommit){
+		virtual_purge((U8*)a->data.ptr + keep, excess);
+	}
+	virtual_block_pop(&a->data, excess);
+	return excess;
+}
+
+// Decommit what the retention policy doesn't keep, `used` is the offset before the reset
+static
+void arena_retain(Arena* a, Size used){
+	Size keep = a->retain;
+	if(a->retention == ArenaRetention_Decay){
+		a->recent_peak = max(used, a->recent_peak - (a->recent_peak >> ARENA_DECAY_SHIFT));
+		keep = max(keep, a->recent_peak);
+	}
+	trace_zone("arena_trim");
+	arena_trim(a, keep);
+}
+
 void arena_free_all(Arena* a){
+	if(a->kind == ArenaKind_Chained){
+		// Keep the newest block, it's the biggest
+		ArenaBlock* block = a->data.ptr;
+		while(block != NULL && block->prev != NULL){
+			ArenaBlock* prev = block->prev->prev;
+			virtual_free(block->prev, block->prev->size + ARENA_BLOCK_GUARD);
+			block->prev = prev;
+		}
+		#if defined(ARENA_DEBUG)
+		arena_debug_release(a, sizeof(ArenaBlock));
+		#endif
+		a->offset = (block != NULL) ? sizeof(ArenaBlock) : 0;
+		return;
+	}
+	#if defined(ARENA_DEBUG)
+	arena_debug_release(a, 0);
+	#endif
+	Size used = a->offset;
 	a->offset = 0;
+	if(hint_unlikely(a->retention != ArenaRetention_All)){
+		arena_retain(a, used);
+	}
 }
 
 void* arena_resize(Arena* a, void* ptr, Size new_size){
+	#if defined(ARENA_DEBUG)
+	ensure(new_size >= 0, "Invalid arena allocation size");
+	if(a->kind == ArenaKind_Virtual && a->last_guarded){
+		Uintptr guard = (Uintptr)a->data.ptr + (Uintptr)a->offset - VIRTUAL_PAGE_SIZE;
+		bool fits = (Uintptr)ptr == a->last_allocation && (Size)(guard - (Uintptr)ptr) >= new_size;
+		return fits ? ptr : NULL;
+	}
+	#endif
 	retry:
 	if((Uintptr)ptr == a->last_allocation){
 		Uintptr base = (Uintptr)a->data.ptr;
@@ -78,6 +291,7 @@ void* arena_resize(Arena* a, void* ptr, Size new_size){
 			if(a->kind == ArenaKind_Virtual){
 				Size to_commit = (current - last_allocation_size + new_size) - limit;
 				if(virtual_block_push(&a->data, to_commit) != NULL){
+					ARENA_STAT(a->stats.commit_count += 1);
 					goto retry;
 				}
 			}
@@ -86,29 +300,148 @@ void* arena_resize(Arena* a, void* ptr, Size new_size){
 		}
 
 		a->offset += new_size - last_allocation_size;
+		ARENA_STAT(a->stats.peak_offset = max(a->stats.peak_offset, a->offset));
 		return ptr;
 	}
 
 	return NULL;
 }
 
-void* arena_realloc(Arena* a, void* ptr, Size old_size, Size new_size, Size align){
+void* (arena_realloc)(Arena* a, void* ptr, Size old_size, Size new_size, Size align){
 	if(ptr == NULL){
-		return arena_alloc(a, new_size, align);
+		return (arena_alloc)(a, new_size, align);
 	}
 	void* new_ptr = arena_resize(a, ptr, new_size);
 	if(new_ptr == NULL){
-		new_ptr = arena_alloc(a, new_size, align);
+		new_ptr = (arena_alloc)(a, new_size, align);
 		if(new_ptr != NULL){
 			mem_copy_no_overlap(new_ptr, ptr, min(old_size, new_size));
+			ARENA_STAT(a->stats.bytes_abandoned += old_size);
 		}
 	}
 	return new_ptr;
 }
 
 void arena_destroy(Arena* a){
+	a->retention = ArenaRetention_All; /* Everything is released anyway */
 	arena_free_all(a);
 	if(a->kind == ArenaKind_Virtual){
 		virtual_block_destroy(&a->data);
 	}
+	else if(a->kind == ArenaKind_Chained){
+		arena_release_blocks(a, NULL);
+	}
+}
+
+#if defined(ARENA_STATS)
+static ArenaCallSite arena_stats_sites[ARENA_STATS_MAX_SITES];
+static AtomicSize arena_stats_site_count = 0;
+static ArenaCallSite arena_stats_untracked = { .file = "(untracked)", .state = 2 };
+
+// Slots are claimed with a CAS and never released, so lookups from any thread
+// only have to wait for a slot that is being claimed right now
+static
+ArenaCallSite* arena_stats_site(char const* file, I32 line){
+	Uintptr h = ((Uintptr)file * 31 + (Uintptr)line) * 0x9e3779b97f4a7c15ull;
+	Size idx = (Size)(h >> 32) & (ARENA_STATS_MAX_SITES - 1);
+
+	for(Size i = 0; i < ARENA_STATS_MAX_SITES; i += 1){
+		ArenaCallSite* site = &arena_stats_sites[(idx + i) & (ARENA_STATS_MAX_SITES - 1)];
+		U32 state = atomic_load_explicit(&site->state, memory_order_acquire);
+		if(state == 0){
+			if(atomic_compare_exchange_strong_explicit(&site->state, &state, 1, memory_order_acquire, memory_order_acquire)){
+				site->file = file;
+				site->line = line;
+				atomic_fetch_add_explicit(&arena_stats_site_count, 1, memory_order_relaxed);
+				atomic_store_explicit(&site->state, 2, memory_order_release);
+				return site;
+			}
+		}
+		while(state != 2){
+			cpu_relax();
+			state = atomic_load_explicit(&site->state, memory_order_acquire);
+		}
+		if(site->file == file && site->line == line){
+			return site;
+		}
+	}
+	return &arena_stats_untracked;
+}
+
+static_assert((ARENA_STATS_MAX_SITES & (ARENA_STATS_MAX_SITES - 1)) == 0, "Site table size must be a power of 2");
+
+// Files are compared by content, the same __FILE__ can have several addresses
+ArenaCallSite const* arena_stats_site_find(char const* file, I32 line){
+	for(Size i = 0; i < ARENA_STATS_MAX_SITES; i += 1){
+		ArenaCallSite const* site = &arena_stats_sites[i];
+		if(atomic_load_explicit(&site->state, memory_order_acquire) == 2 &&
+		   site->line == line && str_eq(str_from(site->file), str_from(file)))
+		{
+			return site;
+		}
+	}
+	return NULL;
+}
+
+void* arena_alloc_tracked(Arena* a, Size size, Size align, char const* file, I32 line){
+	ArenaCallSite* site = arena_stats_site(file, line);
+	atomic_fetch_add_explicit(&site->alloc_count, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&site->bytes_requested, size, memory_order_relaxed);
+	return (arena_alloc)(a, size, align);
+}
+
+void* arena_realloc_tracked(Arena* a, void* ptr, Size old_size, Size new_size, Size align, char const* file, I32 line){
+	ArenaCallSite* site = arena_stats_site(file, line);
+	atomic_fetch_add_explicit(&site->alloc_count, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&site->bytes_requested, new_size, memory_order_relaxed);
+	return (arena_realloc)(a, ptr, old_size, new_size, align);
+}
+
+#ifndef NO_STDIO
+#define ARENA_STATS_DUMP_SITES 16
+
+void arena_stats_dump(Arena* a, char const* name){
+	ArenaStats st = a->stats;
+	printf("Arena '%s'\n", name);
+	printf("  allocations:     %td\n", st.alloc_count);
+	printf("  requested:       %td bytes\n", st.bytes_requested);
+	printf("  padding:         %td bytes\n", st.bytes_padding);
+	printf("  abandoned:       %td bytes\n", st.bytes_abandoned);
+	printf("  offset:          %td bytes (peak %td)\n", a->offset, st.peak_offset);
+	printf("  commited:        %td / %td bytes\n", a->data.commited, a->data.reserved);
+	printf("  commit calls:    %td\n", st.commit_count);
+
+	// Selection of the biggest sites, call sites are shared by every arena
+	// and may still be counting while they're printed
+	bool shown[ARENA_STATS_MAX_SITES] = {0};
+	Size site_bytes[ARENA_STATS_MAX_SITES] = {0};
+	for(Size i = 0; i < ARENA_STATS_MAX_SITES; i += 1){
+		ArenaCallSite* site = &arena_stats_sites[i];
+		shown[i] = atomic_load_explicit(&site->state, memory_order_acquire) != 2;
+		site_bytes[i] = atomic_load_explicit(&site->bytes_requested, memory_order_relaxed);
+	}
+	printf("  top call sites (of %td, all arenas):\n", atomic_load_explicit(&arena_stats_site_count, memory_order_relaxed));
+	for(Size n = 0; n < ARENA_STATS_DUMP_SITES; n += 1){
+		Size best = -1;
+		for(Size i = 0; i < ARENA_STATS_MAX_SITES; i += 1){
+			if(shown[i]){ continue; }
+			if(best < 0 || site_bytes[i] > site_bytes[best]){
+				best = i;
+			}
+		}
+		if(best < 0){ break; }
+		shown[best] = true;
+		ArenaCallSite* site = &arena_stats_sites[best];
+		printf("    %s:%d  %td allocations, %td bytes\n", site->file, site->line,
+			atomic_load_explicit(&site->alloc_count, memory_order_relaxed), site_bytes[best]);
+	}
+	Size untracked = atomic_load_explicit(&arena_stats_untracked.alloc_count, memory_order_relaxed);
+	if(untracked > 0){
+		printf("    %s  %td allocations, %td bytes\n", arena_stats_untracked.file, untracked,
+			atomic_load_explicit(&arena_stats_untracked.bytes_requested, memory_order_relaxed));
+	}
 }
+#else
+void arena_stats_dump(Arena* a, char const* name){ (void)a; (void)name; }
+#endif
+#endif
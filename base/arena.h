@@ -6,21 +6,105 @@
 #include "virtual_memory.h"
 
 typedef struct Arena Arena;
+typedef struct ArenaTemp ArenaTemp;
+typedef struct ArenaBlock ArenaBlock;
 
 typedef enum ArenaKind ArenaKind;
+typedef enum ArenaRetention ArenaRetention;
 
 enum ArenaKind {
 	ArenaKind_Buffer = 0,  // Uses single fixed length buffer, it's the most basic type of arena.
 	ArenaKind_Virtual = 1, // Uses a single buffer with a big reserved address space, committing pages as necessary
+	ArenaKind_Chained = 2, // Uses a list of blocks mapped as needed, each one bigger than the last. Nothing is reserved up front
 };
 
 #define ARENA_VIRTUAL_BLOCK_SIZE (16 * KiB)
 
+// Blocks of chained arenas double in size up to this, bigger allocations get a block of their own size
+#define ARENA_CHAINED_MAX_BLOCK (64 * MiB)
+
+// Header at the start of every block of a chained arena, `data` of the arena is the newest block
+struct ArenaBlock {
+	ArenaBlock* prev;
+	Size size;
+};
+
+// What a virtual arena keeps committed when it's reset with arena_free_all
+enum ArenaRetention {
+	ArenaRetention_All = 0,   // Keep every committed page, the default
+	ArenaRetention_Fixed = 1, // Keep `retain` bytes
+	ArenaRetention_Decay = 2, // Keep what recent resets used, at least `retain` bytes. Spikes fade out over a few resets
+};
+
+// Share of the remembered peak forgotten on every reset by ArenaRetention_Decay, as a shift (1/4)
+#define ARENA_DECAY_SHIFT 2
+
+// With ARENA_DEBUG defined allocation sizes are checked, virtual arenas end
+// every allocation at a page boundary followed by an inaccessible guard page
+// and freed memory is filled with ARENA_POISON_BYTE. Allocations of virtual
+// arenas can only shrink in place in that mode. Once the reservation has no
+// room left for a page and its guard, allocations are packed without guards.
+// Chained arenas pack allocations but get a guard page past every block.
+#define ARENA_POISON_BYTE 0xcd
+
+#if defined(ARENA_STATS)
+// Max number of distinct call sites tracked, shared by all arenas
+#define ARENA_STATS_MAX_SITES 512
+
+typedef struct ArenaStats ArenaStats;
+typedef struct ArenaCallSite ArenaCallSite;
+
+struct ArenaStats {
+	Size alloc_count;
+	Size bytes_requested;
+	Size bytes_padding;   // Lost to alignment
+	Size bytes_abandoned; // Left behind when arena_realloc had to move an allocation
+	Size peak_offset;
+	Size commit_count;    // Calls to virtual_block_push
+};
+
+// Claimed with a CAS on `state` (0: free, 1: being claimed, 2: ready), counters are updated atomically
+struct ArenaCallSite {
+	char const* file;
+	I32  line;
+	AtomicU32  state;
+	AtomicSize alloc_count;
+	AtomicSize bytes_requested;
+};
+
+#define ARENA_STAT(Expr) do { Expr; } while(0)
+#else
+#define ARENA_STAT(Expr) do { } while(0)
+#endif
+
 struct Arena {
 	MemoryBlock data;
 	Size offset;
 	U8 kind;
+	U8 retention;
+	bool eager_decommit; // Give pages back right away instead of when the OS needs memory
 	Uintptr last_allocation;
+	Size retain;
+	Size recent_peak;    // Decayed peak offset, for ArenaRetention_Decay
+	bool numa_bound;     // Pages, and blocks mapped later, are bound to numa_node
+	I32  numa_node;
+	#if defined(ARENA_DEBUG)
+	bool last_guarded;   // Last allocation is followed by a guard page
+	#endif
+	#if defined(ARENA_STATS)
+	ArenaStats stats;
+	#endif
+};
+
+// Saved arena state, everything allocated after it is freed by arena_temp_end
+struct ArenaTemp {
+	Arena* arena;
+	void* block;
+	Size offset;
+	Uintptr last_allocation;
+	#if defined(ARENA_DEBUG)
+	bool last_guarded;
+	#endif
 };
 
 // Helper macro
@@ -32,6 +116,9 @@ bool arena_init_buffer(Arena* a, U8* data, Size len);
 // Initialize a memory arena with a reserved virtual address space
 bool arena_init_virtual(Arena* a, Size reserve);
 
+// Initialize a chained memory arena, mapping a first block of `block_size` bytes (at least ARENA_VIRTUAL_BLOCK_SIZE)
+bool arena_init_chained(Arena* a, Size block_size);
+
 // Deinit the arena
 void arena_destroy(Arena *a);
 
@@ -41,10 +128,74 @@ void* arena_resize(Arena* a, void* ptr, Size new_size);
 // Try to resize allocation in-place, otherwhise re-allocates
 void* arena_realloc(Arena* a, void* ptr, Size old_size, Size new_size, Size align);
 
-// Reset arena, marking all its owned pointers as freed
+// Reset arena, marking all its owned pointers as freed. Virtual arenas decommit pages according to their retention policy,
+// chained arenas keep only their newest block
 void arena_free_all(Arena* a);
 
+// Release the blocks of a chained arena newer than `block`
+void arena_release_blocks(Arena* a, void* block);
+
+// Set what arena_free_all keeps committed, see ArenaRetention. With `eager` set the rest is dropped right away (MADV_DONTNEED)
+void arena_set_retention(Arena* a, U8 retention, Size retain, bool eager);
+
+// Decommit pages past max(keep, offset), no-op for buffer arenas. Returns the number of bytes decommitted
+Size arena_trim(Arena* a, Size keep);
+
+// Place the arena's memory on NUMA `node`, including blocks a chained arena maps later.
+// Best called before the arena is used, touched pages have to be migrated. Returns false for buffer arenas or if binding failed
+bool arena_bind_node(Arena* a, I32 node);
+
 // Allocate `size` bytes aligned to `align`, return null on failure
 void *arena_alloc(Arena* a, Size size, Size align);
 
+#if defined(ARENA_DEBUG)
+// Lift the guard pages past `offset` and poison everything after it
+void arena_debug_release(Arena* a, Size offset);
+#endif
+
+// Begin a temporary region
+static inline
+ArenaTemp arena_temp_begin(Arena* a){
+	ArenaTemp tmp = { .arena = a, .block = a->data.ptr, .offset = a->offset, .last_allocation = a->last_allocation };
+	#if defined(ARENA_DEBUG)
+	tmp.last_guarded = a->last_guarded;
+	#endif
+	return tmp;
+}
+
+// Free everything allocated since the region began
+static inline
+void arena_temp_end(ArenaTemp tmp){
+	if(hint_unlikely(tmp.arena->data.ptr != tmp.block)){
+		arena_release_blocks(tmp.arena, tmp.block);
+	}
+	#if defined(ARENA_DEBUG)
+	arena_debug_release(tmp.arena, tmp.offset);
+	#endif
+	tmp.arena->offset = tmp.offset;
+	tmp.arena->last_allocation = tmp.last_allocation;
+	#if defined(ARENA_DEBUG)
+	tmp.arena->last_guarded = tmp.last_guarded;
+	#endif
+}
+
+#if defined(ARENA_STATS)
+void* arena_alloc_tracked(Arena* a, Size size, Size align, char const* file, I32 line);
+
+void* arena_realloc_tracked(Arena* a, void* ptr, Size old_size, Size new_size, Size align, char const* file, I32 line);
+
+// Attribute allocations to their call site
+#define arena_alloc(A, S, Al) arena_alloc_tracked((A), (S), (Al), __FILE__, __LINE__)
+#define arena_realloc(A, P, Old, New, Al) arena_realloc_tracked((A), (P), (Old), (New), (Al), __FILE__, __LINE__)
+
+// Print arena statistics followed by the call sites that requested the most memory
+void arena_stats_dump(Arena* a, char const* name);
+
+// Counters of the call site at `file`:`line`, null if it never allocated
+ArenaCallSite const* arena_stats_site_find(char const* file, I32 line);
+#else
+static inline
+void arena_stats_dump(Arena* a, char const* name){ (void)a; (void)name; }
+#endif
+
 #endif /* Include guard */
@@ -0,0 +1,65 @@
+#include "arena_pool.h"
+#include "memory.h"
+
+bool arena_pool_init(ArenaPool* p, Arena* arena, Size count, Size reserve, Size retain){
+	return arena_pool_init_node(p, arena, count, reserve, retain, -1);
+}
+
+bool arena_pool_init_node(ArenaPool* p, Arena* arena, Size count, Size reserve, Size retain, I32 node){
+	if(count <= 0 || retain < 0 || retain > reserve){ return false; }
+	mem_set(p, 0, sizeof(*p));
+	p->arenas = arena_push(arena, Arena, count);
+	if(p->arenas == NULL || !mpmc_queue_init(&p->idle, arena, count)){ return false; }
+	p->retain = align_forward_size(retain, VIRTUAL_PAGE_SIZE);
+
+	for(Size i = 0; i < count; i += 1){
+		Arena* a = &p->arenas[i];
+		if(!arena_init_virtual(a, reserve)){
+			p->count = i;
+			arena_pool_destroy(p);
+			return false;
+		}
+		if(node >= 0 && !arena_bind_node(a, node)){
+			arena_destroy(a);
+			p->count = i;
+			arena_pool_destroy(p);
+			return false;
+		}
+		p->count = i + 1;
+		arena_set_retention(a, ArenaRetention_Fixed, p->retain, false);
+
+		// Fault the retained pages in now rather than on the first request
+		U8* warm = arena_alloc(a, p->retain, 1);
+		if(warm != NULL){ mem_set(warm, 0, p->retain); }
+		arena_free_all(a);
+		mpmc_queue_push_wait(&p->idle, a);
+	}
+	return true;
+}
+
+void arena_pool_destroy(ArenaPool* p){
+	Size idle = 0;
+	void* item = NULL;
+	while(mpmc_queue_pop(&p->idle, &item)){ idle += 1; }
+	ensure(idle == p->count, "Arena pool destroyed with arenas still in use");
+	for(Size i = 0; i < p->count; i += 1){
+		arena_destroy(&p->arenas[i]);
+	}
+	p->count = 0;
+}
+
+Arena* arena_pool_acquire(ArenaPool* p){
+	void* a = NULL;
+	return mpmc_queue_pop(&p->idle, &a) ? a : NULL;
+}
+
+Arena* arena_pool_acquire_wait(ArenaPool* p){
+	return mpmc_queue_pop_wait(&p->idle);
+}
+
+void arena_pool_release(ArenaPool* p, Arena* a){
+	ensure(a >= p->arenas && a < p->arenas + p->count, "Arena doesn't belong to the pool");
+	arena_free_all(a);
+	// There's a cell for every arena, so this only waits for pops in flight
+	mpmc_queue_push_wait(&p->idle, a);
+}
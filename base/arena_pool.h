@@ -0,0 +1,42 @@
+#ifndef _arena_pool_h_include_
+#define _arena_pool_h_include_
+
+#include "base.h"
+#include "arena.h"
+#include "queue.h"
+
+typedef struct ArenaPool ArenaPool;
+
+// Fixed set of virtual arenas handed out to requests and taken back when they
+// finish. Arenas come back reset and trimmed to `retain` committed bytes,
+// which stay resident, so steady state handling makes no mmap/munmap calls
+// and takes no first-touch page faults below that size. Acquire and release
+// are lock-free and can be called from any thread.
+struct ArenaPool {
+	Arena*    arenas;
+	Size      count;
+	Size      retain;
+	MpmcQueue idle;
+};
+
+// Initialize pool of `count` arenas reserving `reserve` bytes each, with their first `retain` bytes committed and touched.
+// Bookkeeping is allocated from `arena`. Returns false on failure
+bool arena_pool_init(ArenaPool* p, Arena* arena, Size count, Size reserve, Size retain);
+
+// Same as arena_pool_init, with the memory of every arena bound to NUMA `node` (see arena_bind_node), -1 for no binding.
+// Keep one pool per node to give workers arenas on their own node
+bool arena_pool_init_node(ArenaPool* p, Arena* arena, Size count, Size reserve, Size retain, I32 node);
+
+// Destroy every arena, all of them must have been released
+void arena_pool_destroy(ArenaPool* p);
+
+// Get an idle arena, null if all of them are in use
+Arena* arena_pool_acquire(ArenaPool* p);
+
+// Get an idle arena, blocking while all of them are in use
+Arena* arena_pool_acquire_wait(ArenaPool* p);
+
+// Reset arena and give it back to the pool
+void arena_pool_release(ArenaPool* p, Arena* a);
+
+#endif /* Include guard */
@@ -5,7 +5,9 @@
 
 #include "strings.c"
 #include "memory.c"
+#include "hash.c"
 #include "arena.c"
+#include "pool.c"
 
 #if !defined(TARGET_OS_LINUX) && !defined(TARGET_OS_WINDOWS)
 #error "TARGET_OS_* macro not speficied, this platform is either unsupported or you forgot it."
@@ -14,8 +16,23 @@
 #include "virtual_memory.c"
 #include "virtual_memory_linux.c"
 #include "virtual_memory_windows.c"
+#include "heap.c"
+#include "allocator.c"
+
+#include "thread_linux.c"
+#include "thread_windows.c"
+#include "jobs.c"
+#include "queue.c"
+#include "arena_pool.c"
+
+#include "timing_linux.c"
+#include "timing_windows.c"
 
 #include "filesystem.h"
+#include "filesystem.c"
 #include "filesystem_linux.c"
 #include "filesystem_windows.c"
+#include "string_builder.c"
+
+#include "trace.c"
 
@@ -44,6 +44,9 @@ typedef _Atomic(int64_t) AtomicI64;
 typedef _Atomic(Size)    AtomicSize;
 typedef _Atomic(Uintptr) AtomicUintptr;
 
+// Used to pad data written by different threads, avoiding false sharing
+#define CACHE_LINE_SIZE 64
+
 // This is to avoid conflict with stdlib's "abs()"
 #define abs_val(X) (( (X) < 0ll) ? -(X) : (X))
 
@@ -6,25 +6,26 @@
 //     T*   v
 //     Size len;
 //     Size cap;
-//     Arena* arena;
+//     Allocator allocator;
 // }
 
+#include "allocator.h"
+
 #define DYN_ARRAY_MIN_CAP 16
 
-#define dyn_array_resize(ArrPtr, NewCap) do {                                                           \
-	Size _da_tmp_new_cap_ = max(DYN_ARRAY_MIN_CAP, NewCap);                                             \
-	void* _da_tmp_new_data_ = arena_realloc((ArrPtr)->arena,                                            \
-		(ArrPtr)->v,                                                                                    \
-		(ArrPtr)->cap * sizeof(typeof(*(ArrPtr)->v)),                                                   \
-		_da_tmp_new_cap_ * sizeof(typeof(*(ArrPtr)->v)),                                                \
-		alignof(typeof(*(ArrPtr)->v)));                                                                 \
-															                                            \
-	if(hint_likely(_da_tmp_new_data_ != NULL)){                                                         \
-		Size _da_tmp_copy_count_ = sizeof(typeof(*(ArrPtr)->v)) * min((ArrPtr)->len, _da_tmp_new_cap_); \
-		mem_copy(_da_tmp_new_data_, (ArrPtr)->v, _da_tmp_copy_count_);                                  \
-		(ArrPtr)->v = _da_tmp_new_data_;                                                                \
-		(ArrPtr)->cap = _da_tmp_new_cap_;                                                               \
-	}                                                                                                   \
+#define dyn_array_resize(ArrPtr, NewCap) do {                                   \
+	Size _da_tmp_new_cap_ = max(DYN_ARRAY_MIN_CAP, NewCap);                     \
+	void* _da_tmp_new_data_ = mem_realloc((ArrPtr)->allocator,                  \
+		(ArrPtr)->v,                                                            \
+		(ArrPtr)->cap * sizeof(typeof(*(ArrPtr)->v)),                           \
+		_da_tmp_new_cap_ * sizeof(typeof(*(ArrPtr)->v)),                        \
+		alignof(typeof(*(ArrPtr)->v)));                                         \
+																				\
+	if(hint_likely(_da_tmp_new_data_ != NULL)){                                 \
+		(ArrPtr)->v = _da_tmp_new_data_;                                        \
+		(ArrPtr)->cap = _da_tmp_new_cap_;                                       \
+		(ArrPtr)->len = min((ArrPtr)->len, _da_tmp_new_cap_);                   \
+	}                                                                           \
 } while(0)
 
 #define dyn_array_push(ArrPtr, Elem) do {                  \
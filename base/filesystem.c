@@ -0,0 +1,88 @@
+#include "filesystem.h"
+#include "memory.h"
+#include "strings.h"
+
+bool file_writer_init(FileWriter* w, FileHandle handle, Arena* arena, Size buf_size){
+	mem_set(w, 0, sizeof(*w));
+	if(buf_size <= 0){ return false; }
+	w->buf = arena_push(arena, U8, buf_size);
+	if(w->buf == NULL){ return false; }
+	w->handle = handle;
+	w->cap = buf_size;
+	return true;
+}
+
+// Send pending segments (terminated by the buffered bytes after `*seg_start`)
+// to the OS and reset the buffer.
+static
+bool file_writer_send(FileWriter* w, String* segments, Size* seg_count, Size* seg_start){
+	if(w->len > *seg_start){
+		segments[*seg_count] = str_from_bytes(&w->buf[*seg_start], w->len - *seg_start);
+		*seg_count += 1;
+	}
+
+	if(*seg_count > 0 && file_write_vectored(w->handle, segments, *seg_count) < 0){
+		w->failed = true;
+	}
+
+	*seg_count = 0;
+	*seg_start = 0;
+	w->len = 0;
+	return !w->failed;
+}
+
+bool file_writer_write_many(FileWriter* w, String const* parts, Size count){
+	if(w->failed){ return false; }
+
+	// +1 for the trailing buffered bytes
+	String segments[FILE_WRITER_MAX_SEGMENTS + 1];
+	Size seg_count = 0;
+	Size seg_start = 0; // Start of buffered bytes not yet referenced by a segment
+
+	for(Size i = 0; i < count; i += 1){
+		String part = parts[i];
+		if(part.len <= 0){ continue; }
+
+		bool small = part.len < FILE_WRITER_COPY_THRESHOLD && part.len <= w->cap;
+		if(small){
+			if(part.len > (w->cap - w->len)){
+				if(!file_writer_send(w, segments, &seg_count, &seg_start)){ return false; }
+			}
+			mem_copy_no_overlap(&w->buf[w->len], part.v, part.len);
+			w->len += part.len;
+			continue;
+		}
+
+		if(seg_count + 2 > FILE_WRITER_MAX_SEGMENTS){
+			if(!file_writer_send(w, segments, &seg_count, &seg_start)){ return false; }
+		}
+
+		if(w->len > seg_start){
+			segments[seg_count] = str_from_bytes(&w->buf[seg_start], w->len - seg_start);
+			seg_count += 1;
+			seg_start = w->len;
+		}
+		segments[seg_count] = part;
+		seg_count += 1;
+	}
+
+	if(seg_count > 0){
+		return file_writer_send(w, segments, &seg_count, &seg_start);
+	}
+	return true;
+}
+
+bool file_writer_write(FileWriter* w, String s){
+	return file_writer_write_many(w, &s, 1);
+}
+
+bool file_writer_flush(FileWriter* w){
+	if(w->failed){ return false; }
+	if(w->len > 0){
+		if(file_write(w->handle, w->buf, w->len) != w->len){
+			w->failed = true;
+		}
+		w->len = 0;
+	}
+	return !w->failed;
+}
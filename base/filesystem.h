@@ -5,15 +5,25 @@
 #include "arena.h"
 
 #define FS_MAX_FILENAME_LEN 256
+#define FS_MAX_PATH_LEN 4096
+
+// Max number of slices sent to the OS in a single vectored write
+#define FILE_WRITER_MAX_SEGMENTS 64
+
+// Writes smaller than this are copied into the writer's buffer, bigger ones
+// are handed to the OS directly as part of a vectored write.
+#define FILE_WRITER_COPY_THRESHOLD (2 * KiB)
 
 typedef struct FileHandle FileHandle;
 typedef struct DirectoryHandle DirectoryHandle;
+typedef struct FileWriter FileWriter;
+typedef struct FileMapping FileMapping;
 
 typedef enum {
 	Read   = (1 << 0),
 	Write  = (1 << 1),
 	Append = (1 << 2),
-	Create = (1 << 2),
+	Create = (1 << 3),
 } FileMode;
 
 struct FileHandle {
@@ -24,4 +34,57 @@ struct DirectoryHandle {
 	Uintptr _v;
 };
 
+// Buffered file writer. Small writes get coalesced into `buf`, big writes are
+// not copied, they get sent together with the buffered data in a single
+// vectored write.
+struct FileWriter {
+	FileHandle handle;
+	U8*  buf;
+	Size len;
+	Size cap;
+	bool failed;
+};
+
+// Read-only view of a whole file
+struct FileMapping {
+	U8 const* data;
+	Size len;
+	Uintptr _v;
+};
+
+// Open file at `path` with a combination of FileMode flags, returns success status
+bool file_open(FileHandle* handle, String path, U8 mode);
+
+// Close file handle
+void file_close(FileHandle handle);
+
+// Get handle to the process' standard output
+FileHandle file_stdout();
+
+// Write `len` bytes to file, returns number of bytes written or -1 on error
+Size file_write(FileHandle handle, U8 const* data, Size len);
+
+// Write `count` slices to file in order, using as few calls to the OS as
+// possible. Returns number of bytes written or -1 on error
+Size file_write_vectored(FileHandle handle, String const* parts, Size count);
+
+// Map the file at `path` read-only into memory, returns success status
+bool file_map(FileMapping* mapping, String path);
+
+// Unmap a file mapped with file_map
+void file_unmap(FileMapping* mapping);
+
+// Initialize a buffered writer with a `buf_size` buffer allocated from arena
+bool file_writer_init(FileWriter* w, FileHandle handle, Arena* arena, Size buf_size);
+
+// Write string to writer, returns false if writer is in a failed state
+bool file_writer_write(FileWriter* w, String s);
+
+// Write many (possibly non-contiguous) slices to writer without concatenating
+// them first, returns false if writer is in a failed state
+bool file_writer_write_many(FileWriter* w, String const* parts, Size count);
+
+// Send all buffered data to the OS, returns false if writer is in a failed state
+bool file_writer_flush(FileWriter* w);
+
 #endif /* Include guard */
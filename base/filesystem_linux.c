@@ -1,9 +1,131 @@
 #include "filesystem.h"
 
 #if defined(TARGET_OS_LINUX)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+
+bool file_open(FileHandle* handle, String path, U8 mode){
+	char cpath[FS_MAX_PATH_LEN];
+	if(path.len <= 0 || path.len >= FS_MAX_PATH_LEN){ return false; }
+	mem_copy_no_overlap(cpath, path.v, path.len);
+	cpath[path.len] = 0;
+
+	int flags = O_CLOEXEC;
+	if((mode & Read) && (mode & (Write | Append))){
+		flags |= O_RDWR;
+	}
+	else if(mode & (Write | Append)){
+		flags |= O_WRONLY;
+	}
+	else {
+		flags |= O_RDONLY;
+	}
+
+	if(mode & Append){ flags |= O_APPEND; }
+	if(mode & Create){ flags |= O_CREAT | ((mode & Append) ? 0 : O_TRUNC); }
+
+	int fd = open(cpath, flags, 0644);
+	if(fd < 0){ return false; }
+	handle->_v = (Uintptr)fd;
+	return true;
+}
+
+void file_close(FileHandle handle){
+	close((int)handle._v);
+}
+
+FileHandle file_stdout(){
+	return (FileHandle){ ._v = STDOUT_FILENO };
+}
+
+Size file_write(FileHandle handle, U8 const* data, Size len){
+	Size written = 0;
+	while(written < len){
+		ssize_t n = write((int)handle._v, data + written, len - written);
+		if(n < 0){
+			if(errno == EINTR){ continue; }
+			return -1;
+		}
+		written += n;
+	}
+	return written;
+}
+
+Size file_write_vectored(FileHandle handle, String const* parts, Size count){
+	struct iovec iov[FILE_WRITER_MAX_SEGMENTS];
+	Size written = 0;
+	Size part = 0;
+
+	while(part < count){
+		Size iov_count = 0;
+		for(; part < count && iov_count < FILE_WRITER_MAX_SEGMENTS; part += 1){
+			if(parts[part].len <= 0){ continue; }
+			iov[iov_count] = (struct iovec){
+				.iov_base = (void*)parts[part].v,
+				.iov_len = parts[part].len,
+			};
+			iov_count += 1;
+		}
+
+		// Retry until the whole batch is out, the OS is allowed to do partial writes
+		struct iovec* cur = iov;
+		while(iov_count > 0){
+			ssize_t n = writev((int)handle._v, cur, iov_count);
+			if(n < 0){
+				if(errno == EINTR){ continue; }
+				return -1;
+			}
+			written += n;
+
+			while(iov_count > 0 && (Size)cur->iov_len <= n){
+				n -= cur->iov_len;
+				cur += 1;
+				iov_count -= 1;
+			}
+			if(iov_count > 0){
+				cur->iov_base = (U8*)cur->iov_base + n;
+				cur->iov_len -= n;
+			}
+		}
+	}
+
+	return written;
+}
+
+bool file_map(FileMapping* mapping, String path){
+	FileHandle handle = {0};
+	if(!file_open(&handle, path, Read)){ return false; }
+
+	struct stat info;
+	if(fstat((int)handle._v, &info) < 0 || info.st_size <= 0){
+		file_close(handle);
+		return false;
+	}
+
+	void* data = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, (int)handle._v, 0);
+	file_close(handle); /* The mapping keeps its own reference */
+	if(data == MAP_FAILED){ return false; }
+
+	*mapping = (FileMapping){
+		.data = data,
+		.len = info.st_size,
+	};
+	return true;
+}
+
+void file_unmap(FileMapping* mapping){
+	if(mapping->data != NULL){
+		munmap((void*)mapping->data, mapping->len);
+	}
+	*mapping = (FileMapping){0};
+}
+
 // TODO:
-// - file_open / file_close
-// - file_read / file_write
+// - file_read
 // - file_delete
 // - file_exists
 // - dir_open / dir_close
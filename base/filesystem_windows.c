@@ -1,13 +1,105 @@
 #include "filesystem.h"
 
 #if defined(TARGET_OS_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+bool file_open(FileHandle* handle, String path, U8 mode){
+	char cpath[FS_MAX_PATH_LEN];
+	if(path.len <= 0 || path.len >= FS_MAX_PATH_LEN){ return false; }
+	mem_copy_no_overlap(cpath, path.v, path.len);
+	cpath[path.len] = 0;
+
+	DWORD access = 0;
+	if(mode & Read){ access |= GENERIC_READ; }
+	if(mode & Write){ access |= GENERIC_WRITE; }
+	if(mode & Append){ access |= FILE_APPEND_DATA; }
+
+	DWORD disposition = OPEN_EXISTING;
+	if(mode & Create){
+		disposition = (mode & Append) ? OPEN_ALWAYS : CREATE_ALWAYS;
+	}
+
+	HANDLE h = CreateFileA(cpath, access, FILE_SHARE_READ, NULL, disposition, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(h == INVALID_HANDLE_VALUE){ return false; }
+	handle->_v = (Uintptr)h;
+	return true;
+}
+
+void file_close(FileHandle handle){
+	CloseHandle((HANDLE)handle._v);
+}
+
+FileHandle file_stdout(){
+	return (FileHandle){ ._v = (Uintptr)GetStdHandle(STD_OUTPUT_HANDLE) };
+}
+
+Size file_write(FileHandle handle, U8 const* data, Size len){
+	Size written = 0;
+	while(written < len){
+		DWORD n = 0;
+		DWORD to_write = (DWORD)min(len - written, (Size)(1u << 30));
+		if(!WriteFile((HANDLE)handle._v, data + written, to_write, &n, NULL)){
+			return -1;
+		}
+		written += n;
+	}
+	return written;
+}
+
+// WriteFileGather only works with unbuffered, page aligned I/O, so this just
+// issues one write per slice.
+Size file_write_vectored(FileHandle handle, String const* parts, Size count){
+	Size written = 0;
+	for(Size i = 0; i < count; i += 1){
+		Size n = file_write(handle, parts[i].v, parts[i].len);
+		if(n < 0){ return -1; }
+		written += n;
+	}
+	return written;
+}
+
+bool file_map(FileMapping* mapping, String path){
+	FileHandle handle = {0};
+	if(!file_open(&handle, path, Read)){ return false; }
+
+	LARGE_INTEGER size;
+	if(!GetFileSizeEx((HANDLE)handle._v, &size) || size.QuadPart <= 0){
+		file_close(handle);
+		return false;
+	}
+
+	HANDLE section = CreateFileMappingA((HANDLE)handle._v, NULL, PAGE_READONLY, 0, 0, NULL);
+	file_close(handle); /* The section keeps its own reference */
+	if(section == NULL){ return false; }
+
+	void* data = MapViewOfFile(section, FILE_MAP_READ, 0, 0, 0);
+	if(data == NULL){
+		CloseHandle(section);
+		return false;
+	}
+
+	*mapping = (FileMapping){
+		.data = data,
+		.len = (Size)size.QuadPart,
+		._v = (Uintptr)section,
+	};
+	return true;
+}
+
+void file_unmap(FileMapping* mapping){
+	if(mapping->data != NULL){
+		UnmapViewOfFile(mapping->data);
+		CloseHandle((HANDLE)mapping->_v);
+	}
+	*mapping = (FileMapping){0};
+}
+
 // TODO:
-// - file_open / file_close
-// - file_read / file_write
+// - file_read
 // - file_delete
 // - file_exists
 // - dir_open / dir_close
 // - dir_list
 // - file_info (stat)
 #endif
-
@@ -0,0 +1,238 @@
+#include "hash.h"
+#include "memory.h"
+
+#if defined(__x86_64__) && (defined(__clang__) || defined(__GNUC__))
+#define HASH_AES_KERNEL
+#include <immintrin.h>
+#endif
+
+static U64 const hash_secret[4] = {
+	0x2d358dccaa6c78a5ull, 0x8bb84b93962eacc9ull,
+	0x4b33a62ed433d4a3ull, 0x4d5a2da51de1aa47ull,
+};
+
+// 64x64 -> 128 bit multiply, returns both halves in a and b
+static inline
+void hash_mum(U64* a, U64* b){
+	#if defined(__SIZEOF_INT128__)
+	__uint128_t r = (__uint128_t)*a * *b;
+	*a = (U64)r;
+	*b = (U64)(r >> 64);
+	#else
+	U64 ha = *a >> 32, hb = *b >> 32, la = (U32)*a, lb = (U32)*b;
+	U64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+	U64 t = rl + (rm0 << 32);
+	U64 c = t < rl;
+	U64 lo = t + (rm1 << 32);
+	c += lo < t;
+	U64 hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+	*a = lo;
+	*b = hi;
+	#endif
+}
+
+static inline
+U64 hash_mix(U64 a, U64 b){
+	hash_mum(&a, &b);
+	return a ^ b;
+}
+
+// Little endian reads, so values are the same on every host
+static inline
+U64 hash_read64(U8 const* p){
+	U64 v;
+	mem_builtin_copy(&v, p, 8);
+	#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	v = __builtin_bswap64(v);
+	#endif
+	return v;
+}
+
+static inline
+U64 hash_read32(U8 const* p){
+	U32 v;
+	mem_builtin_copy(&v, p, 4);
+	#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+	v = __builtin_bswap32(v);
+	#endif
+	return v;
+}
+
+static inline
+U64 hash_seed(U64 seed){
+	return seed ^ hash_mix(seed ^ hash_secret[0], hash_secret[1]);
+}
+
+// Consume one 48 byte block
+static inline
+void hash_block(U64* seed, U64* see1, U64* see2, U8 const* p){
+	*seed = hash_mix(hash_read64(p) ^ hash_secret[1], hash_read64(p + 8) ^ *seed);
+	*see1 = hash_mix(hash_read64(p + 16) ^ hash_secret[2], hash_read64(p + 24) ^ *see1);
+	*see2 = hash_mix(hash_read64(p + 32) ^ hash_secret[3], hash_read64(p + 40) ^ *see2);
+}
+
+static inline
+U64 hash_finish(U64 a, U64 b, U64 seed, Size len){
+	a ^= hash_secret[1];
+	b ^= seed;
+	hash_mum(&a, &b);
+	return hash_mix(a ^ hash_secret[0] ^ (U64)len, b ^ hash_secret[1]);
+}
+
+// Inputs of at most 16 bytes
+static inline
+U64 hash_small(U8 const* p, Size len, U64 seed){
+	U64 a = 0, b = 0;
+	if(len >= 4){
+		Size mid = (len >> 3) << 2;
+		a = (hash_read32(p) << 32) | hash_read32(p + mid);
+		b = (hash_read32(p + len - 4) << 32) | hash_read32(p + len - 4 - mid);
+	}
+	else if(len > 0){
+		a = ((U64)p[0] << 16) | ((U64)p[len >> 1] << 8) | p[len - 1];
+	}
+	return hash_finish(a, b, seed, len);
+}
+
+// The 1..48 bytes left after the blocks. p[-16, 0) must be readable when the
+// input was longer than 16 bytes
+static inline
+U64 hash_tail(U8 const* p, Size i, U64 seed, Size len){
+	while(i > 16){
+		seed = hash_mix(hash_read64(p) ^ hash_secret[1], hash_read64(p + 8) ^ seed);
+		p += 16;
+		i -= 16;
+	}
+	return hash_finish(hash_read64(p + i - 16), hash_read64(p + i - 8), seed, len);
+}
+
+U64 hash_bytes(void const* data, Size len, U64 seed){
+	U8 const* p = data;
+	seed = hash_seed(seed);
+	if(len <= 16){
+		return hash_small(p, len, seed);
+	}
+
+	Size i = len;
+	if(i > 48){
+		U64 see1 = seed, see2 = seed;
+		do {
+			hash_block(&seed, &see1, &see2, p);
+			p += 48;
+			i -= 48;
+		} while(i > 48);
+		seed ^= see1 ^ see2;
+	}
+	return hash_tail(p, i, seed, len);
+}
+
+HashState hash_begin(U64 seed){
+	seed = hash_seed(seed);
+	return (HashState){ .seed = seed, .see1 = seed, .see2 = seed };
+}
+
+void hash_update(HashState* state, void const* data, Size len){
+	U8 const* p = data;
+	U8* pending = state->buf + 16;
+	state->total += len;
+
+	while(len > 0){
+		// Blocks are only consumed once there's at least one byte after them,
+		// the last 1..48 bytes are always left for hash_end
+		if(state->pending == 0 && len > 48){
+			do {
+				hash_block(&state->seed, &state->see1, &state->see2, p);
+				p += 48;
+				len -= 48;
+			} while(len > 48);
+			state->blocks = true;
+			mem_copy_no_overlap(state->buf, p - 16, 16);
+		}
+
+		Size take = min(len, 48 - state->pending);
+		mem_copy_no_overlap(pending + state->pending, p, take);
+		state->pending += take;
+		p += take;
+		len -= take;
+
+		if(state->pending == 48 && len > 0){
+			hash_block(&state->seed, &state->see1, &state->see2, pending);
+			state->blocks = true;
+			mem_copy_no_overlap(state->buf, pending + 32, 16);
+			state->pending = 0;
+		}
+	}
+}
+
+U64 hash_end(HashState const* state){
+	U8 const* pending = state->buf + 16;
+	if(state->total <= 16){
+		return hash_small(pending, state->total, state->seed);
+	}
+	U64 seed = state->seed;
+	if(state->blocks){
+		seed ^= state->see1 ^ state->see2;
+	}
+	return hash_tail(pending, state->pending, seed, state->total);
+}
+
+#if defined(HASH_AES_KERNEL)
+static AtomicU32 hash_aes_support = 0; /* 0: unknown, 1: no, 2: yes */
+
+static inline
+bool hash_has_aes(){
+	U32 s = atomic_load_explicit(&hash_aes_support, memory_order_relaxed);
+	if(hint_unlikely(s == 0)){
+		__builtin_cpu_init();
+		s = __builtin_cpu_supports("aes") ? 2 : 1;
+		atomic_store_explicit(&hash_aes_support, s, memory_order_relaxed);
+	}
+	return s == 2;
+}
+
+// 64 bytes per iteration over four lanes, each lane is one AES round per
+// block. Tails are read as overlapping 16 byte blocks ending at the input end.
+__attribute__((target("aes")))
+static
+U64 hash_aes(U8 const* p, Size len, U64 seed){
+	__m128i key = _mm_set_epi64x((long long)(seed ^ hash_secret[0]), (long long)(seed ^ hash_secret[1]));
+	__m128i l0 = _mm_xor_si128(key, _mm_set1_epi64x((long long)(len * hash_secret[2])));
+	__m128i l1 = _mm_xor_si128(key, _mm_set1_epi64x((long long)hash_secret[3]));
+	__m128i l2 = l0, l3 = l1;
+
+	Size i = 0;
+	for(; i + 64 <= len; i += 64){
+		l0 = _mm_aesenc_si128(l0, _mm_loadu_si128((__m128i const*)(p + i)));
+		l1 = _mm_aesenc_si128(l1, _mm_loadu_si128((__m128i const*)(p + i + 16)));
+		l2 = _mm_aesenc_si128(l2, _mm_loadu_si128((__m128i const*)(p + i + 32)));
+		l3 = _mm_aesenc_si128(l3, _mm_loadu_si128((__m128i const*)(p + i + 48)));
+	}
+	// Remaining 0..63 bytes: up to three full blocks, then the block ending at len
+	for(; i + 16 < len; i += 16){
+		l0 = _mm_aesenc_si128(l0, _mm_loadu_si128((__m128i const*)(p + i)));
+		__m128i t = l0; l0 = l1; l1 = l2; l2 = l3; l3 = t;
+	}
+	if(i < len){
+		l1 = _mm_aesenc_si128(l1, _mm_loadu_si128((__m128i const*)(p + len - 16)));
+	}
+
+	__m128i x = _mm_aesenc_si128(_mm_xor_si128(l0, l2), l1);
+	__m128i y = _mm_aesenc_si128(_mm_xor_si128(l1, l3), l0);
+	x = _mm_aesenc_si128(x, key);
+	y = _mm_aesenc_si128(y, key);
+	__m128i r = _mm_aesenc_si128(_mm_xor_si128(x, y), key);
+	U64 lo = (U64)_mm_cvtsi128_si64(r);
+	U64 hi = (U64)_mm_cvtsi128_si64(_mm_unpackhi_epi64(r, r));
+	return lo ^ hi;
+}
+#endif
+
+U64 hash_bytes_local(void const* data, Size len, U64 seed){
+	#if defined(HASH_AES_KERNEL)
+	// The scalar path wins below a block of four lanes
+	if(len >= 64 && hash_has_aes()){
+		return hash_aes(data, len, seed);
+	}
+	#endif
+	return hash_bytes(data, len, seed);
+}
@@ -0,0 +1,60 @@
+#ifndef _hash_h_include_
+#define _hash_h_include_
+
+#include "base.h"
+
+// Seeded 64-bit hashing in the style of wyhash: 128-bit multiply-fold mixing,
+// 48 bytes per iteration over three independent lanes for long inputs.
+//
+// hash_bytes is stable, the same input and seed give the same value on every
+// machine and build, so it can be stored or used for content addressing.
+// hash_bytes_local uses AES-NI when the CPU has it and is only meant for
+// in-memory tables: its values differ between machines and must never be
+// persisted.
+
+typedef struct HashState HashState;
+
+// Incremental hashing of chunked input, the result equals hash_bytes over
+// the concatenated chunks
+struct HashState {
+	U64  seed;
+	U64  see1;
+	U64  see2;
+	Size total;
+	Size pending;     // Bytes in buf after the history
+	bool blocks;      // At least one 48 byte block was consumed
+	U8   buf[16 + 48]; // Last 16 consumed bytes followed by pending input
+};
+
+// Hash `len` bytes with `seed`
+U64 hash_bytes(void const* data, Size len, U64 seed);
+
+// Faster hash for in-process use only, see above
+U64 hash_bytes_local(void const* data, Size len, U64 seed);
+
+// Begin incremental hash
+HashState hash_begin(U64 seed);
+
+// Feed the next chunk of input
+void hash_update(HashState* state, void const* data, Size len);
+
+// Get hash of everything fed so far, the state can keep being updated
+U64 hash_end(HashState const* state);
+
+static inline
+U64 hash_str(String s, U64 seed){
+	return hash_bytes(s.v, s.len, seed);
+}
+
+static inline
+U64 hash_str_local(String s, U64 seed){
+	return hash_bytes_local(s.v, s.len, seed);
+}
+
+// Combine two hashes, order dependent
+static inline
+U64 hash_combine(U64 a, U64 b){
+	return a ^ (b + 0x9e3779b97f4a7c15ull + (a << 6) + (a >> 2));
+}
+
+#endif /* Include guard */
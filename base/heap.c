@@ -0,0 +1,367 @@
+#include "heap.h"
+#include "memory.h"
+#include "virtual_memory.h"
+
+#if defined(TARGET_OS_LINUX) || defined(TARGET_OS_WINDOWS)
+
+// Classes go in steps of 16 up to 128, then 4 steps per power of 2 up to HEAP_SMALL_MAX
+static inline
+I32 heap_size_class(Size size){
+	if(size <= 128){
+		return (I32)((max(size, 1) - 1) >> 4);
+	}
+	Size s = size - 1;
+	I32 p = 63 - __builtin_clzll((U64)s);
+	return 8 + (p - 7) * 4 + (I32)((s - ((Size)1 << p)) >> (p - 2));
+}
+
+static inline
+Size heap_class_size(I32 class){
+	if(class < 8){
+		return (Size)(class + 1) * 16;
+	}
+	I32 group = (class - 8) / 4;
+	I32 step  = (class - 8) % 4;
+	I32 p = 7 + group;
+	return ((Size)1 << p) + (Size)(step + 1) * ((Size)1 << (p - 2));
+}
+
+static_assert(HEAP_SMALL_MAX == 8192, "Size class table assumes HEAP_SMALL_MAX is 8 KiB");
+
+static inline
+HeapSpan* heap_span_at(Heap* h, Size page){
+	return &((HeapSpan*)h->span_table.ptr)[page];
+}
+
+static inline
+U32* heap_owners(Heap* h){
+	return (U32*)h->owner_table.ptr;
+}
+
+static inline
+void heap_list_push(HeapSpan** list, HeapSpan* span){
+	span->prev = NULL;
+	span->next = *list;
+	if(*list != NULL){ (*list)->prev = span; }
+	*list = span;
+}
+
+static inline
+void heap_list_remove(HeapSpan** list, HeapSpan* span){
+	if(span->prev != NULL){ span->prev->next = span->next; }
+	else { *list = span->next; }
+	if(span->next != NULL){ span->next->prev = span->prev; }
+	span->next = span->prev = NULL;
+}
+
+bool heap_init(Heap* h, Size reserve){
+	if(reserve <= 0){ return false; }
+	mem_set(h, 0, sizeof(*h));
+
+	reserve = align_forward_size(reserve, VIRTUAL_PAGE_SIZE);
+	h->page_count = reserve / VIRTUAL_PAGE_SIZE;
+	if(h->page_count > (Size)UINT32_MAX){ return false; }
+
+	h->base = virtual_reserve(reserve);
+	h->span_table  = virtual_block_create(h->page_count * sizeof(HeapSpan));
+	h->owner_table = virtual_block_create(h->page_count * sizeof(U32));
+
+	if(h->base == NULL || h->span_table.ptr == NULL || h->owner_table.ptr == NULL){
+		heap_destroy(h);
+		return false;
+	}
+	return true;
+}
+
+void heap_destroy(Heap* h){
+	if(h->base != NULL){
+		virtual_free(h->base, h->page_count * VIRTUAL_PAGE_SIZE);
+	}
+	if(h->span_table.ptr != NULL){
+		virtual_block_destroy(&h->span_table);
+	}
+	if(h->owner_table.ptr != NULL){
+		virtual_block_destroy(&h->owner_table);
+	}
+	mem_set(h, 0, sizeof(*h));
+}
+
+// Make sure metadata tables cover `pages` pages
+static
+bool heap_grow_tables(Heap* h, Size pages){
+	Size span_bytes = pages * sizeof(HeapSpan);
+	if(span_bytes > h->span_table.commited){
+		if(virtual_block_push(&h->span_table, span_bytes - h->span_table.commited) == NULL){
+			return false;
+		}
+	}
+	Size owner_bytes = pages * sizeof(U32);
+	if(owner_bytes > h->owner_table.commited){
+		if(virtual_block_push(&h->owner_table, owner_bytes - h->owner_table.commited) == NULL){
+			return false;
+		}
+	}
+	return true;
+}
+
+// Write span descriptor for run [first, first + pages)
+static
+HeapSpan* heap_span_set(Heap* h, Size first, Size pages, I16 kind){
+	HeapSpan* span = heap_span_at(h, first);
+	mem_set(span, 0, sizeof(*span));
+	span->first_page = (U32)first;
+	span->pages = (U32)pages;
+	span->size_class = kind;
+
+	U32* owners = heap_owners(h);
+	if(kind >= 0){
+		// Slab objects can live in any of its pages
+		for(Size i = 0; i < pages; i += 1){
+			owners[first + i] = (U32)first;
+		}
+	}
+	else {
+		owners[first] = (U32)first;
+		owners[first + pages - 1] = (U32)first;
+	}
+	return span;
+}
+
+static
+void heap_release_run(Heap* h, HeapSpan* span){
+	Size first = span->first_page;
+	Size pages = span->pages;
+
+	virtual_decommit(h->base + first * VIRTUAL_PAGE_SIZE, pages * VIRTUAL_PAGE_SIZE);
+
+	// Coalesce with neighbours
+	if(first > 0){
+		HeapSpan* left = heap_span_at(h, heap_owners(h)[first - 1]);
+		if(left->size_class == HeapSpan_Free){
+			heap_list_remove(&h->free_runs, left);
+			first = left->first_page;
+			pages += left->pages;
+		}
+	}
+	if(first + pages < h->top_page){
+		HeapSpan* right = heap_span_at(h, first + pages);
+		if(right->size_class == HeapSpan_Free){
+			heap_list_remove(&h->free_runs, right);
+			pages += right->pages;
+		}
+	}
+
+	if(first + pages == (Size)h->top_page){
+		h->top_page = first; /* Give run back to the untouched region */
+		return;
+	}
+
+	HeapSpan* run = heap_span_set(h, first, pages, HeapSpan_Free);
+	heap_list_push(&h->free_runs, run);
+}
+
+// Split `pages` off the start of a free run, the rest stays free
+static
+void heap_split_free_run(Heap* h, HeapSpan* run, Size pages){
+	heap_list_remove(&h->free_runs, run);
+	if(run->pages > pages){
+		HeapSpan* rest = heap_span_set(h, run->first_page + pages, run->pages - pages, HeapSpan_Free);
+		heap_list_push(&h->free_runs, rest);
+	}
+}
+
+static
+HeapSpan* heap_alloc_run(Heap* h, Size pages, I16 kind){
+	Size first = -1;
+
+	for(HeapSpan* run = h->free_runs; run != NULL; run = run->next){
+		if(run->pages >= pages){
+			first = run->first_page;
+			heap_split_free_run(h, run, pages);
+			break;
+		}
+	}
+
+	if(first < 0){
+		if(h->top_page + pages > h->page_count){
+			return NULL; /* Out of address space */
+		}
+		if(!heap_grow_tables(h, h->top_page + pages)){
+			return NULL; /* Memory error */
+		}
+		first = h->top_page;
+		h->top_page += pages;
+	}
+
+	if(virtual_commit(h->base + first * VIRTUAL_PAGE_SIZE, pages * VIRTUAL_PAGE_SIZE) == NULL){
+		HeapSpan* span = heap_span_set(h, first, pages, HeapSpan_Large);
+		heap_release_run(h, span);
+		return NULL; /* Memory error */
+	}
+
+	return heap_span_set(h, first, pages, kind);
+}
+
+static inline
+U32 heap_slab_capacity(I32 class){
+	return (HEAP_SLAB_PAGES * VIRTUAL_PAGE_SIZE) / heap_class_size(class);
+}
+
+static
+void* heap_alloc_small(Heap* h, I32 class){
+	HeapSpan* slab = h->partial[class];
+	if(slab == NULL){
+		slab = heap_alloc_run(h, HEAP_SLAB_PAGES, (I16)class);
+		if(slab == NULL){ return NULL; }
+		heap_list_push(&h->partial[class], slab);
+	}
+
+	void* obj = slab->free_list;
+	if(obj != NULL){
+		slab->free_list = *(void**)obj;
+	}
+	else {
+		obj = h->base + (Size)slab->first_page * VIRTUAL_PAGE_SIZE + (Size)slab->carved * heap_class_size(class);
+		slab->carved += 1;
+	}
+	slab->used += 1;
+
+	if(slab->free_list == NULL && slab->carved == heap_slab_capacity(class)){
+		heap_list_remove(&h->partial[class], slab);
+	}
+	return obj;
+}
+
+void* heap_alloc(Heap* h, Size size, Size align){
+	ensure(mem_valid_alignment(align), "Alignment must be a power of 2");
+	if(size < 0 || align > VIRTUAL_PAGE_SIZE){ return NULL; }
+
+	if(align > 16){
+		size = align_forward_size(size, align);
+	}
+
+	if(size <= HEAP_SMALL_MAX){
+		return heap_alloc_small(h, heap_size_class(size));
+	}
+
+	Size pages = align_forward_size(size, VIRTUAL_PAGE_SIZE) / VIRTUAL_PAGE_SIZE;
+	HeapSpan* span = heap_alloc_run(h, pages, HeapSpan_Large);
+	if(span == NULL){ return NULL; }
+	return h->base + (Size)span->first_page * VIRTUAL_PAGE_SIZE;
+}
+
+static inline
+HeapSpan* heap_span_of(Heap* h, void* ptr){
+	Size page = ((U8*)ptr - h->base) / VIRTUAL_PAGE_SIZE;
+	ensure(page >= 0 && page < h->top_page, "Pointer does not belong to heap");
+	return heap_span_at(h, heap_owners(h)[page]);
+}
+
+void heap_free(Heap* h, void* ptr){
+	if(ptr == NULL){ return; }
+	HeapSpan* span = heap_span_of(h, ptr);
+	ensure(span->size_class != HeapSpan_Free, "Double free");
+
+	if(span->size_class == HeapSpan_Large){
+		heap_release_run(h, span);
+		return;
+	}
+
+	I32 class = span->size_class;
+	bool was_full = span->free_list == NULL && span->carved == heap_slab_capacity(class);
+
+	*(void**)ptr = span->free_list;
+	span->free_list = ptr;
+	span->used -= 1;
+
+	if(was_full){
+		heap_list_push(&h->partial[class], span);
+	}
+
+	// Keep a single empty slab per class around to avoid commit/decommit thrashing
+	if(span->used == 0 && (span->next != NULL || span->prev != NULL)){
+		heap_list_remove(&h->partial[class], span);
+		heap_release_run(h, span);
+	}
+}
+
+Size heap_usable_size(Heap* h, void* ptr){
+	HeapSpan* span = heap_span_of(h, ptr);
+	if(span->size_class >= 0){
+		return heap_class_size(span->size_class);
+	}
+	return (Size)span->pages * VIRTUAL_PAGE_SIZE;
+}
+
+void* heap_resize(Heap* h, void* ptr, Size new_size){
+	if(ptr == NULL || new_size < 0){ return NULL; }
+	HeapSpan* span = heap_span_of(h, ptr);
+
+	if(span->size_class >= 0){
+		return new_size <= heap_class_size(span->size_class) ? ptr : NULL;
+	}
+
+	Size pages = max(align_forward_size(new_size, VIRTUAL_PAGE_SIZE) / VIRTUAL_PAGE_SIZE, 1);
+	Size first = span->first_page;
+	Size old_pages = span->pages;
+
+	if(pages < old_pages){
+		heap_span_set(h, first, pages, HeapSpan_Large);
+		HeapSpan* tail = heap_span_set(h, first + pages, old_pages - pages, HeapSpan_Large);
+		heap_release_run(h, tail);
+		return ptr;
+	}
+	if(pages == old_pages){
+		return ptr;
+	}
+
+	Size extra = pages - old_pages;
+	Size end = first + old_pages;
+	if(end == h->top_page){
+		if(end + extra > h->page_count || !heap_grow_tables(h, end + extra)){
+			return NULL;
+		}
+		h->top_page += extra;
+	}
+	else {
+		HeapSpan* right = heap_span_at(h, end);
+		if(right->size_class != HeapSpan_Free || right->pages < extra){
+			return NULL;
+		}
+		heap_split_free_run(h, right, extra);
+	}
+
+	if(virtual_commit(h->base + end * VIRTUAL_PAGE_SIZE, extra * VIRTUAL_PAGE_SIZE) == NULL){
+		HeapSpan* tail = heap_span_set(h, end, extra, HeapSpan_Large);
+		heap_release_run(h, tail);
+		return NULL;
+	}
+	heap_span_set(h, first, pages, HeapSpan_Large);
+	return ptr;
+}
+
+void* heap_realloc(Heap* h, void* ptr, Size new_size, Size align){
+	if(ptr == NULL){
+		return heap_alloc(h, new_size, align);
+	}
+	void* new_ptr = heap_resize(h, ptr, new_size);
+	if(new_ptr == NULL){
+		new_ptr = heap_alloc(h, new_size, align);
+		if(new_ptr != NULL){
+			mem_copy_no_overlap(new_ptr, ptr, min(heap_usable_size(h, ptr), new_size));
+			heap_free(h, ptr);
+		}
+	}
+	return new_ptr;
+}
+
+void heap_free_all(Heap* h){
+	if(h->top_page > 0){
+		virtual_decommit(h->base, h->top_page * VIRTUAL_PAGE_SIZE);
+	}
+	h->top_page = 0;
+	h->free_runs = NULL;
+	mem_set(h->partial, 0, sizeof(h->partial));
+}
+
+#endif
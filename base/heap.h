@@ -0,0 +1,75 @@
+#ifndef _heap_h_include_
+#define _heap_h_include_
+
+#include "base.h"
+#include "memory.h"
+#include "virtual_memory.h"
+
+// Pages per slab used for small size classes
+#define HEAP_SLAB_PAGES 16
+
+// Allocations bigger than this are served by runs of whole pages
+#define HEAP_SMALL_MAX (8 * KiB)
+
+#define HEAP_SIZE_CLASS_COUNT 32
+
+typedef struct Heap Heap;
+typedef struct HeapSpan HeapSpan;
+
+enum HeapSpanKind {
+	HeapSpan_Free  = -1, // Decommitted run of pages
+	HeapSpan_Large = -2, // Run of pages holding a single big allocation
+	// Values >= 0 are slabs of the corresponding size class
+};
+
+// Contiguous run of pages, its descriptor lives in the span table at the
+// index of its first page.
+struct HeapSpan {
+	HeapSpan* next;
+	HeapSpan* prev;
+	void*     free_list;
+	U32       first_page;
+	U32       pages;
+	U32       used;       // Objects in use (slabs)
+	U32       carved;     // Objects carved out of the slab so far
+	I16       size_class;
+};
+
+// General purpose allocator built directly on top of virtual memory. Small
+// sizes come from size-classed slabs, big ones from page runs. Freed runs are
+// coalesced and decommitted. Not thread safe.
+struct Heap {
+	U8*         base;
+	Size        page_count;  // Reserved pages
+	Size        top_page;    // Pages handed out so far
+	MemoryBlock span_table;  // HeapSpan per page
+	MemoryBlock owner_table; // U32 per page, index of the span owning it
+	HeapSpan*   partial[HEAP_SIZE_CLASS_COUNT]; // Slabs with free objects
+	HeapSpan*   free_runs;
+};
+
+// Initialize heap with `reserve` bytes of address space
+bool heap_init(Heap* h, Size reserve);
+
+// Release all memory owned by heap
+void heap_destroy(Heap* h);
+
+// Allocate `size` bytes aligned to `align` (at most VIRTUAL_PAGE_SIZE), return null on failure
+void* heap_alloc(Heap* h, Size size, Size align);
+
+// Resize allocation in-place, gives back same pointer on success, null on failure
+void* heap_resize(Heap* h, void* ptr, Size new_size);
+
+// Try to resize allocation in-place, otherwhise re-allocates and frees the old one
+void* heap_realloc(Heap* h, void* ptr, Size new_size, Size align);
+
+// Free an allocation, ptr may be null
+void heap_free(Heap* h, void* ptr);
+
+// Free all allocations, decommitting every page
+void heap_free_all(Heap* h);
+
+// Get how many bytes are usable in an allocation
+Size heap_usable_size(Heap* h, void* ptr);
+
+#endif /* Include guard */
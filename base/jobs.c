@@ -0,0 +1,305 @@
+#include "jobs.h"
+#include "memory.h"
+
+#if defined(TARGET_OS_LINUX) || defined(TARGET_OS_WINDOWS)
+
+static _Thread_local JobWorker* jobs_current_worker = NULL;
+
+static_assert((JOB_DEQUE_CAPACITY & (JOB_DEQUE_CAPACITY - 1)) == 0, "Deque capacity must be a power of 2");
+static_assert(sizeof(Job) % sizeof(Uintptr) == 0, "Jobs must be made of whole words");
+
+// A thief may read a slot the owner is overwriting, it then loses the CAS on
+// top and throws the copy away. Relaxed word accesses keep that race defined.
+static inline
+void job_slot_store(AtomicUintptr* slot, Job const* job){
+	Uintptr words[JOB_WORDS];
+	mem_copy_no_overlap(words, job, sizeof(Job));
+	for(Size i = 0; i < (Size)JOB_WORDS; i += 1){
+		atomic_store_explicit(&slot[i], words[i], memory_order_relaxed);
+	}
+}
+
+static inline
+void job_slot_load(AtomicUintptr* slot, Job* job){
+	Uintptr words[JOB_WORDS];
+	for(Size i = 0; i < (Size)JOB_WORDS; i += 1){
+		words[i] = atomic_load_explicit(&slot[i], memory_order_relaxed);
+	}
+	mem_copy_no_overlap(job, words, sizeof(Job));
+}
+
+static
+bool job_deque_push(JobDeque* dq, Job job){
+	I64 b = atomic_load_explicit(&dq->bottom, memory_order_relaxed);
+	I64 t = atomic_load_explicit(&dq->top, memory_order_acquire);
+	if(b - t >= JOB_DEQUE_CAPACITY){
+		return false;
+	}
+	job_slot_store(dq->jobs[b & (JOB_DEQUE_CAPACITY - 1)], &job);
+	atomic_store_explicit(&dq->bottom, b + 1, memory_order_release);
+	return true;
+}
+
+static
+bool job_deque_pop(JobDeque* dq, Job* out){
+	I64 b = atomic_load_explicit(&dq->bottom, memory_order_relaxed) - 1;
+	atomic_store_explicit(&dq->bottom, b, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	I64 t = atomic_load_explicit(&dq->top, memory_order_relaxed);
+
+	if(t > b){
+		atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+		return false; /* Empty */
+	}
+
+	job_slot_load(dq->jobs[b & (JOB_DEQUE_CAPACITY - 1)], out);
+	if(t == b){
+		// Last job, race against thieves
+		bool won = atomic_compare_exchange_strong_explicit(&dq->top, &t, t + 1,
+			memory_order_seq_cst, memory_order_relaxed);
+		atomic_store_explicit(&dq->bottom, b + 1, memory_order_relaxed);
+		return won;
+	}
+	return true;
+}
+
+static
+bool job_deque_steal(JobDeque* dq, Job* out){
+	I64 t = atomic_load_explicit(&dq->top, memory_order_acquire);
+	atomic_thread_fence(memory_order_seq_cst);
+	I64 b = atomic_load_explicit(&dq->bottom, memory_order_acquire);
+
+	if(t >= b){
+		return false; /* Empty */
+	}
+
+	Job job;
+	job_slot_load(dq->jobs[t & (JOB_DEQUE_CAPACITY - 1)], &job);
+	if(!atomic_compare_exchange_strong_explicit(&dq->top, &t, t + 1,
+		memory_order_seq_cst, memory_order_relaxed))
+	{
+		return false; /* Lost the race */
+	}
+	*out = job;
+	return true;
+}
+
+static
+void jobs_run(JobWorker* w, Job* job){
+	ArenaTemp tmp = arena_temp_begin(&w->scratch);
+	JobContext ctx = {
+		.system = w->system,
+		.worker_index = w->index,
+		.node = w->node,
+		.scratch = &w->scratch,
+	};
+	job->func(&ctx, job->data, job->begin, job->end);
+	arena_temp_end(tmp);
+
+	if(job->counter != NULL){
+		atomic_fetch_sub_explicit(&job->counter->pending, 1, memory_order_release);
+	}
+}
+
+static
+bool jobs_try_run(JobWorker* w){
+	Job job;
+	if(job_deque_pop(&w->deque, &job)){
+		jobs_run(w, &job);
+		return true;
+	}
+
+	JobSystem* sys = w->system;
+	w->rng ^= w->rng << 13;
+	w->rng ^= w->rng >> 17;
+	w->rng ^= w->rng << 5;
+	I32 start = (I32)(w->rng % (U32)sys->worker_count);
+
+	for(I32 i = 0; i < sys->worker_count; i += 1){
+		JobWorker* victim = &sys->workers[(start + i) % sys->worker_count];
+		if(victim == w){ continue; }
+		if(job_deque_steal(&victim->deque, &job)){
+			jobs_run(w, &job);
+			return true;
+		}
+	}
+	return false;
+}
+
+static
+void jobs_worker_loop(void* arg){
+	JobWorker* w = arg;
+	JobSystem* sys = w->system;
+	jobs_current_worker = w;
+	if(sys->numa){
+		thread_pin_numa_node(w->node);
+	}
+
+	I32 idle = 0;
+	while(!atomic_load_explicit(&sys->shutdown, memory_order_acquire)){
+		if(jobs_try_run(w)){
+			idle = 0;
+			continue;
+		}
+
+		idle += 1;
+		if(idle < JOBS_SPIN_COUNT){
+			cpu_relax();
+			continue;
+		}
+
+		// Re-check after reading the epoch so a push in between isn't missed
+		U32 epoch = atomic_load(&sys->epoch);
+		if(jobs_try_run(w)){
+			idle = 0;
+			continue;
+		}
+		if(atomic_load(&sys->shutdown)){ break; }
+
+		atomic_fetch_add(&sys->sleepers, 1);
+		futex_wait(&sys->epoch, epoch);
+		atomic_fetch_sub(&sys->sleepers, 1);
+		idle = 0;
+	}
+}
+
+// Stop the threads of workers [1, threads), release the scratch arenas of
+// workers [0, arenas) and the worker memory
+static
+void jobs_teardown(JobSystem* sys, I32 threads, I32 arenas){
+	atomic_store(&sys->shutdown, 1);
+	atomic_fetch_add(&sys->epoch, 1);
+	futex_wake_all(&sys->epoch);
+
+	for(I32 i = 1; i < threads; i += 1){
+		thread_join(&sys->workers[i].thread);
+	}
+	for(I32 i = 0; i < arenas; i += 1){
+		arena_destroy(&sys->workers[i].scratch);
+	}
+	if(sys->worker_memory.ptr != NULL){
+		virtual_block_destroy(&sys->worker_memory);
+	}
+	jobs_current_worker = NULL;
+	mem_set(sys, 0, sizeof(*sys));
+}
+
+static
+bool jobs_start(JobSystem* sys, I32 worker_count, bool numa){
+	mem_set(sys, 0, sizeof(*sys));
+	if(worker_count <= 0){
+		worker_count = thread_cpu_count();
+	}
+	worker_count = clamp(1, worker_count, JOBS_MAX_WORKERS);
+
+	Size size = sizeof(JobWorker) * worker_count;
+	sys->worker_memory = virtual_block_create(size);
+	if(sys->worker_memory.ptr == NULL || virtual_block_push(&sys->worker_memory, size) == NULL){
+		jobs_teardown(sys, 0, 0);
+		return false;
+	}
+	sys->workers = sys->worker_memory.ptr;
+	sys->worker_count = worker_count;
+	I32 nodes = virtual_numa_node_count();
+	sys->numa = numa && nodes > 1;
+
+	for(I32 i = 0; i < worker_count; i += 1){
+		JobWorker* w = &sys->workers[i];
+		w->system = sys;
+		w->index = i;
+		w->rng = 0x9e3779b9u * (U32)(i + 1);
+		if(!arena_init_virtual(&w->scratch, JOBS_SCRATCH_RESERVE)){
+			jobs_teardown(sys, 0, i);
+			return false;
+		}
+		if(sys->numa){
+			w->node = (i == 0) ? thread_numa_node() : (I32)(((Size)i * nodes) / worker_count);
+			arena_bind_node(&w->scratch, w->node);
+		}
+	}
+
+	jobs_current_worker = &sys->workers[0];
+	for(I32 i = 1; i < worker_count; i += 1){
+		JobWorker* w = &sys->workers[i];
+		if(!thread_create(&w->thread, jobs_worker_loop, w)){
+			jobs_teardown(sys, i, worker_count);
+			return false;
+		}
+	}
+	return true;
+}
+
+bool jobs_init(JobSystem* sys, I32 worker_count){
+	return jobs_start(sys, worker_count, false);
+}
+
+bool jobs_init_numa(JobSystem* sys, I32 worker_count){
+	return jobs_start(sys, worker_count, true);
+}
+
+void jobs_destroy(JobSystem* sys){
+	ensure(jobs_current_worker == &sys->workers[0], "jobs_destroy must be called from worker 0");
+	jobs_teardown(sys, sys->worker_count, sys->worker_count);
+}
+
+void jobs_push(JobSystem* sys, JobCounter* counter, JobFunc func, void* data, Size begin, Size end){
+	JobWorker* w = jobs_current_worker;
+	ensure(w != NULL && w->system == sys, "Jobs can only be pushed from a worker thread");
+
+	Job job = {
+		.func = func,
+		.data = data,
+		.begin = begin,
+		.end = end,
+		.counter = counter,
+	};
+
+	if(counter != NULL){
+		atomic_fetch_add_explicit(&counter->pending, 1, memory_order_relaxed);
+	}
+
+	if(!job_deque_push(&w->deque, job)){
+		jobs_run(w, &job);
+		return;
+	}
+
+	atomic_fetch_add(&sys->epoch, 1);
+	if(atomic_load(&sys->sleepers) > 0){
+		futex_wake_one(&sys->epoch);
+	}
+}
+
+void jobs_wait(JobSystem* sys, JobCounter* counter){
+	JobWorker* w = jobs_current_worker;
+	ensure(w != NULL && w->system == sys, "Jobs can only be waited on from a worker thread");
+
+	I32 idle = 0;
+	while(atomic_load_explicit(&counter->pending, memory_order_acquire) > 0){
+		if(jobs_try_run(w)){
+			idle = 0;
+			continue;
+		}
+		idle += 1;
+		if(idle < JOBS_SPIN_COUNT){
+			cpu_relax();
+		}
+		else {
+			thread_yield();
+		}
+	}
+}
+
+void jobs_parallel_for(JobSystem* sys, Size count, Size grain, JobFunc func, void* data){
+	JobCounter counter = {0};
+	grain = max(grain, 1);
+	for(Size begin = 0; begin < count; begin += grain){
+		jobs_push(sys, &counter, func, data, begin, min(begin + grain, count));
+	}
+	jobs_wait(sys, &counter);
+}
+
+I32 jobs_worker_index(){
+	return jobs_current_worker != NULL ? jobs_current_worker->index : -1;
+}
+
+#endif
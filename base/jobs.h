@@ -0,0 +1,107 @@
+#ifndef _jobs_h_include_
+#define _jobs_h_include_
+
+#include "base.h"
+#include "arena.h"
+#include "thread.h"
+#include "virtual_memory.h"
+
+#define JOBS_MAX_WORKERS 64
+
+// Max queued jobs per worker, when full jobs run immediately on push
+#define JOB_DEQUE_CAPACITY 4096
+
+#define JOBS_SCRATCH_RESERVE (256 * MiB)
+
+// Failed attempts to find work before a worker goes to sleep
+#define JOBS_SPIN_COUNT 256
+
+typedef struct Job Job;
+typedef struct JobDeque JobDeque;
+typedef struct JobWorker JobWorker;
+typedef struct JobSystem JobSystem;
+typedef struct JobContext JobContext;
+typedef struct JobCounter JobCounter;
+
+typedef void (*JobFunc)(JobContext* ctx, void* data, Size begin, Size end);
+
+// Number of unfinished jobs, waited on with jobs_wait
+struct JobCounter {
+	AtomicSize pending;
+};
+
+struct Job {
+	JobFunc func;
+	void* data;
+	Size begin;
+	Size end;
+	JobCounter* counter;
+};
+
+struct JobContext {
+	JobSystem* system;
+	I32 worker_index;
+	I32 node;       // NUMA node of the worker, 0 unless started with jobs_init_numa
+	Arena* scratch; // Per-worker arena, reset after every job
+};
+
+// Words of a Job, deque slots are accessed word by word with relaxed atomics
+#define JOB_WORDS (sizeof(Job) / sizeof(Uintptr))
+
+// Chase-Lev work stealing deque, the owner pushes and pops at the bottom,
+// thieves take from the top.
+struct JobDeque {
+	alignas(CACHE_LINE_SIZE) AtomicI64 top;
+	alignas(CACHE_LINE_SIZE) AtomicI64 bottom;
+	alignas(CACHE_LINE_SIZE) AtomicUintptr jobs[JOB_DEQUE_CAPACITY][JOB_WORDS];
+};
+
+struct JobWorker {
+	JobDeque deque;
+	Arena scratch;
+	Thread thread;
+	JobSystem* system;
+	I32 index;
+	I32 node;
+	U32 rng;
+};
+
+struct JobSystem {
+	JobWorker*  workers;
+	I32         worker_count;
+	MemoryBlock worker_memory;
+	alignas(CACHE_LINE_SIZE) AtomicU32 epoch; // Bumped on every push, idle workers sleep on it
+	AtomicU32   sleepers;
+	AtomicU32   shutdown;
+	bool        numa;
+};
+
+// Start a job system with `worker_count` workers (<= 0 means one per CPU).
+// The calling thread becomes worker 0 and runs jobs while waiting. Returns
+// false, with everything started so far stopped again, if memory or a thread
+// couldn't be obtained.
+bool jobs_init(JobSystem* sys, I32 worker_count);
+
+// Same as jobs_init, but workers are spread evenly over the NUMA nodes: each
+// one is pinned to its node's CPUs and its scratch arena is bound to that
+// node. Worker 0 isn't pinned, it uses the node the caller runs on. Same as
+// jobs_init on single node machines.
+bool jobs_init_numa(JobSystem* sys, I32 worker_count);
+
+// Stop and join all workers, must be called from worker 0
+void jobs_destroy(JobSystem* sys);
+
+// Queue job running func(data, begin, end). Must be called from a worker
+// thread, jobs may push more jobs. counter may be null.
+void jobs_push(JobSystem* sys, JobCounter* counter, JobFunc func, void* data, Size begin, Size end);
+
+// Run jobs until counter reaches 0
+void jobs_wait(JobSystem* sys, JobCounter* counter);
+
+// Split [0, count) in ranges of at most `grain` and process them in parallel, blocks until done
+void jobs_parallel_for(JobSystem* sys, Size count, Size grain, JobFunc func, void* data);
+
+// Index of the calling thread's worker, -1 if it isn't a worker
+I32 jobs_worker_index();
+
+#endif /* Include guard */
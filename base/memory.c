@@ -14,20 +14,453 @@
 #define mem_compare_impl         __builtin_memcmp
 #endif
 
-void mem_set(void* p, U8 val, Size count){
-	mem_set_impl(p, val, count);
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__clang__) || defined(__GNUC__)) && defined(__SSE2__)
+#define MEM_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+typedef enum {
+	MemLevel_Unknown = 0,
+	MemLevel_Generic,
+	MemLevel_SSE2,
+	MemLevel_AVX2,
+	MemLevel_AVX512,
+} MemLevel;
+
+static AtomicU32 mem_level = MemLevel_Unknown;
+
+// Best kernel set for this CPU, detected on first use
+static inline
+U32 mem_cpu_level(){
+	U32 level = atomic_load_explicit(&mem_level, memory_order_relaxed);
+	if(hint_likely(level != MemLevel_Unknown)){
+		return level;
+	}
+
+	level = MemLevel_Generic;
+	#if defined(MEM_X86_KERNELS)
+	__builtin_cpu_init();
+	level = MemLevel_SSE2;
+	if(__builtin_cpu_supports("avx2")){ level = MemLevel_AVX2; }
+	if(__builtin_cpu_supports("avx512f")){ level = MemLevel_AVX512; }
+	#endif
+	atomic_store_explicit(&mem_level, level, memory_order_relaxed);
+	return level;
+}
+
+#if defined(MEM_X86_KERNELS)
+// The copy kernels load the first and last vector up front, write the middle
+// with aligned stores and the two edge vectors last. All loads of an
+// iteration happen before its stores, so they're also correct for
+// overlapping buffers where dest < src.
+
+static
+void mem_copy_sse2(U8* d, U8 const* s, Size n, bool non_temporal){
+	if(n <= 128){
+		__m128i a = _mm_loadu_si128((__m128i const*)(s + 0));
+		__m128i b = _mm_loadu_si128((__m128i const*)(s + 16));
+		__m128i c = _mm_loadu_si128((__m128i const*)(s + 32));
+		__m128i e = _mm_loadu_si128((__m128i const*)(s + 48));
+		__m128i f = _mm_loadu_si128((__m128i const*)(s + n - 64));
+		__m128i g = _mm_loadu_si128((__m128i const*)(s + n - 48));
+		__m128i h = _mm_loadu_si128((__m128i const*)(s + n - 32));
+		__m128i i = _mm_loadu_si128((__m128i const*)(s + n - 16));
+		_mm_storeu_si128((__m128i*)(d + 0), a);
+		_mm_storeu_si128((__m128i*)(d + 16), b);
+		_mm_storeu_si128((__m128i*)(d + 32), c);
+		_mm_storeu_si128((__m128i*)(d + 48), e);
+		_mm_storeu_si128((__m128i*)(d + n - 64), f);
+		_mm_storeu_si128((__m128i*)(d + n - 48), g);
+		_mm_storeu_si128((__m128i*)(d + n - 32), h);
+		_mm_storeu_si128((__m128i*)(d + n - 16), i);
+		return;
+	}
+	__m128i head = _mm_loadu_si128((__m128i const*)s);
+	__m128i tail = _mm_loadu_si128((__m128i const*)(s + n - 16));
+	U8* end = d + n;
+	Size skip = 16 - ((Uintptr)d & 15);
+	U8* p = d + skip;
+	s += skip;
+
+	if(non_temporal){
+		for(; end - p >= 64; p += 64, s += 64){
+			__m128i a = _mm_loadu_si128((__m128i const*)(s + 0));
+			__m128i b = _mm_loadu_si128((__m128i const*)(s + 16));
+			__m128i c = _mm_loadu_si128((__m128i const*)(s + 32));
+			__m128i e = _mm_loadu_si128((__m128i const*)(s + 48));
+			_mm_stream_si128((__m128i*)(p + 0), a);
+			_mm_stream_si128((__m128i*)(p + 16), b);
+			_mm_stream_si128((__m128i*)(p + 32), c);
+			_mm_stream_si128((__m128i*)(p + 48), e);
+		}
+		_mm_sfence();
+	}
+	for(; end - p >= 64; p += 64, s += 64){
+		__m128i a = _mm_loadu_si128((__m128i const*)(s + 0));
+		__m128i b = _mm_loadu_si128((__m128i const*)(s + 16));
+		__m128i c = _mm_loadu_si128((__m128i const*)(s + 32));
+		__m128i e = _mm_loadu_si128((__m128i const*)(s + 48));
+		_mm_store_si128((__m128i*)(p + 0), a);
+		_mm_store_si128((__m128i*)(p + 16), b);
+		_mm_store_si128((__m128i*)(p + 32), c);
+		_mm_store_si128((__m128i*)(p + 48), e);
+	}
+	for(; end - p > 16; p += 16, s += 16){
+		_mm_store_si128((__m128i*)p, _mm_loadu_si128((__m128i const*)s));
+	}
+	_mm_storeu_si128((__m128i*)(end - 16), tail);
+	_mm_storeu_si128((__m128i*)d, head);
 }
 
-void mem_copy(void* dest, void const * src, Size count){
+__attribute__((target("avx2")))
+static
+void mem_copy_avx2(U8* d, U8 const* s, Size n, bool non_temporal){
+	if(n <= 128){
+		__m256i a = _mm256_loadu_si256((__m256i const*)(s + 0));
+		__m256i b = _mm256_loadu_si256((__m256i const*)(s + 32));
+		__m256i c = _mm256_loadu_si256((__m256i const*)(s + n - 64));
+		__m256i e = _mm256_loadu_si256((__m256i const*)(s + n - 32));
+		_mm256_storeu_si256((__m256i*)(d + 0), a);
+		_mm256_storeu_si256((__m256i*)(d + 32), b);
+		_mm256_storeu_si256((__m256i*)(d + n - 64), c);
+		_mm256_storeu_si256((__m256i*)(d + n - 32), e);
+		return;
+	}
+	if(n <= 256){
+		__m256i a = _mm256_loadu_si256((__m256i const*)(s + 0));
+		__m256i b = _mm256_loadu_si256((__m256i const*)(s + 32));
+		__m256i c = _mm256_loadu_si256((__m256i const*)(s + 64));
+		__m256i e = _mm256_loadu_si256((__m256i const*)(s + 96));
+		__m256i f = _mm256_loadu_si256((__m256i const*)(s + n - 128));
+		__m256i g = _mm256_loadu_si256((__m256i const*)(s + n - 96));
+		__m256i h = _mm256_loadu_si256((__m256i const*)(s + n - 64));
+		__m256i i = _mm256_loadu_si256((__m256i const*)(s + n - 32));
+		_mm256_storeu_si256((__m256i*)(d + 0), a);
+		_mm256_storeu_si256((__m256i*)(d + 32), b);
+		_mm256_storeu_si256((__m256i*)(d + 64), c);
+		_mm256_storeu_si256((__m256i*)(d + 96), e);
+		_mm256_storeu_si256((__m256i*)(d + n - 128), f);
+		_mm256_storeu_si256((__m256i*)(d + n - 96), g);
+		_mm256_storeu_si256((__m256i*)(d + n - 64), h);
+		_mm256_storeu_si256((__m256i*)(d + n - 32), i);
+		return;
+	}
+	__m256i head = _mm256_loadu_si256((__m256i const*)s);
+	__m256i tail = _mm256_loadu_si256((__m256i const*)(s + n - 32));
+	U8* end = d + n;
+	Size skip = 32 - ((Uintptr)d & 31);
+	U8* p = d + skip;
+	s += skip;
+
+	if(non_temporal){
+		for(; end - p >= 128; p += 128, s += 128){
+			__m256i a = _mm256_loadu_si256((__m256i const*)(s + 0));
+			__m256i b = _mm256_loadu_si256((__m256i const*)(s + 32));
+			__m256i c = _mm256_loadu_si256((__m256i const*)(s + 64));
+			__m256i e = _mm256_loadu_si256((__m256i const*)(s + 96));
+			_mm256_stream_si256((__m256i*)(p + 0), a);
+			_mm256_stream_si256((__m256i*)(p + 32), b);
+			_mm256_stream_si256((__m256i*)(p + 64), c);
+			_mm256_stream_si256((__m256i*)(p + 96), e);
+		}
+		_mm_sfence();
+	}
+	for(; end - p >= 128; p += 128, s += 128){
+		__m256i a = _mm256_loadu_si256((__m256i const*)(s + 0));
+		__m256i b = _mm256_loadu_si256((__m256i const*)(s + 32));
+		__m256i c = _mm256_loadu_si256((__m256i const*)(s + 64));
+		__m256i e = _mm256_loadu_si256((__m256i const*)(s + 96));
+		_mm256_store_si256((__m256i*)(p + 0), a);
+		_mm256_store_si256((__m256i*)(p + 32), b);
+		_mm256_store_si256((__m256i*)(p + 64), c);
+		_mm256_store_si256((__m256i*)(p + 96), e);
+	}
+	for(; end - p > 32; p += 32, s += 32){
+		_mm256_store_si256((__m256i*)p, _mm256_loadu_si256((__m256i const*)s));
+	}
+	_mm256_storeu_si256((__m256i*)(end - 32), tail);
+	_mm256_storeu_si256((__m256i*)d, head);
+}
+
+__attribute__((target("avx512f")))
+static
+void mem_copy_avx512(U8* d, U8 const* s, Size n, bool non_temporal){
+	if(n <= 256){
+		mem_copy_avx2(d, s, n, non_temporal);
+		return;
+	}
+	__m512i head = _mm512_loadu_si512(s);
+	__m512i tail = _mm512_loadu_si512(s + n - 64);
+	U8* end = d + n;
+	Size skip = 64 - ((Uintptr)d & 63);
+	U8* p = d + skip;
+	s += skip;
+
+	if(non_temporal){
+		for(; end - p >= 256; p += 256, s += 256){
+			__m512i a = _mm512_loadu_si512(s + 0);
+			__m512i b = _mm512_loadu_si512(s + 64);
+			__m512i c = _mm512_loadu_si512(s + 128);
+			__m512i e = _mm512_loadu_si512(s + 192);
+			_mm512_stream_si512((void*)(p + 0), a);
+			_mm512_stream_si512((void*)(p + 64), b);
+			_mm512_stream_si512((void*)(p + 128), c);
+			_mm512_stream_si512((void*)(p + 192), e);
+		}
+		_mm_sfence();
+	}
+	for(; end - p >= 256; p += 256, s += 256){
+		__m512i a = _mm512_loadu_si512(s + 0);
+		__m512i b = _mm512_loadu_si512(s + 64);
+		__m512i c = _mm512_loadu_si512(s + 128);
+		__m512i e = _mm512_loadu_si512(s + 192);
+		_mm512_store_si512(p + 0, a);
+		_mm512_store_si512(p + 64, b);
+		_mm512_store_si512(p + 128, c);
+		_mm512_store_si512(p + 192, e);
+	}
+	for(; end - p > 64; p += 64, s += 64){
+		_mm512_store_si512(p, _mm512_loadu_si512(s));
+	}
+	_mm512_storeu_si512(end - 64, tail);
+	_mm512_storeu_si512(d, head);
+}
+
+static
+void mem_set_sse2(U8* d, U8 val, Size n){
+	__m128i v = _mm_set1_epi8((char)val);
+	U8* end = d + n;
+	_mm_storeu_si128((__m128i*)d, v);
+	_mm_storeu_si128((__m128i*)(end - 16), v);
+	U8* p = d + (16 - ((Uintptr)d & 15));
+
+	if(n >= MEM_NON_TEMPORAL_THRESHOLD){
+		for(; end - p >= 64; p += 64){
+			_mm_stream_si128((__m128i*)(p + 0), v);
+			_mm_stream_si128((__m128i*)(p + 16), v);
+			_mm_stream_si128((__m128i*)(p + 32), v);
+			_mm_stream_si128((__m128i*)(p + 48), v);
+		}
+		_mm_sfence();
+	}
+	for(; end - p >= 64; p += 64){
+		_mm_store_si128((__m128i*)(p + 0), v);
+		_mm_store_si128((__m128i*)(p + 16), v);
+		_mm_store_si128((__m128i*)(p + 32), v);
+		_mm_store_si128((__m128i*)(p + 48), v);
+	}
+	for(; end - p > 16; p += 16){
+		_mm_store_si128((__m128i*)p, v);
+	}
+}
+
+__attribute__((target("avx2")))
+static
+void mem_set_avx2(U8* d, U8 val, Size n){
+	__m256i v = _mm256_set1_epi8((char)val);
+	U8* end = d + n;
+	if(n <= 128){
+		_mm256_storeu_si256((__m256i*)(d + 0), v);
+		_mm256_storeu_si256((__m256i*)(d + 32), v);
+		_mm256_storeu_si256((__m256i*)(end - 64), v);
+		_mm256_storeu_si256((__m256i*)(end - 32), v);
+		return;
+	}
+	if(n <= 256){
+		_mm256_storeu_si256((__m256i*)(d + 0), v);
+		_mm256_storeu_si256((__m256i*)(d + 32), v);
+		_mm256_storeu_si256((__m256i*)(d + 64), v);
+		_mm256_storeu_si256((__m256i*)(d + 96), v);
+		_mm256_storeu_si256((__m256i*)(end - 128), v);
+		_mm256_storeu_si256((__m256i*)(end - 96), v);
+		_mm256_storeu_si256((__m256i*)(end - 64), v);
+		_mm256_storeu_si256((__m256i*)(end - 32), v);
+		return;
+	}
+	_mm256_storeu_si256((__m256i*)d, v);
+	_mm256_storeu_si256((__m256i*)(end - 32), v);
+	U8* p = d + (32 - ((Uintptr)d & 31));
+
+	if(n >= MEM_NON_TEMPORAL_THRESHOLD){
+		for(; end - p >= 128; p += 128){
+			_mm256_stream_si256((__m256i*)(p + 0), v);
+			_mm256_stream_si256((__m256i*)(p + 32), v);
+			_mm256_stream_si256((__m256i*)(p + 64), v);
+			_mm256_stream_si256((__m256i*)(p + 96), v);
+		}
+		_mm_sfence();
+	}
+	for(; end - p >= 128; p += 128){
+		_mm256_store_si256((__m256i*)(p + 0), v);
+		_mm256_store_si256((__m256i*)(p + 32), v);
+		_mm256_store_si256((__m256i*)(p + 64), v);
+		_mm256_store_si256((__m256i*)(p + 96), v);
+	}
+	for(; end - p > 32; p += 32){
+		_mm256_store_si256((__m256i*)p, v);
+	}
+}
+
+__attribute__((target("avx512f")))
+static
+void mem_set_avx512(U8* d, U8 val, Size n){
+	if(n <= 256){
+		mem_set_avx2(d, val, n);
+		return;
+	}
+	__m512i v = _mm512_set1_epi32((int)(0x01010101u * val));
+	U8* end = d + n;
+	_mm512_storeu_si512(d, v);
+	_mm512_storeu_si512(end - 64, v);
+	U8* p = d + (64 - ((Uintptr)d & 63));
+
+	if(n >= MEM_NON_TEMPORAL_THRESHOLD){
+		for(; end - p >= 256; p += 256){
+			_mm512_stream_si512((void*)(p + 0), v);
+			_mm512_stream_si512((void*)(p + 64), v);
+			_mm512_stream_si512((void*)(p + 128), v);
+			_mm512_stream_si512((void*)(p + 192), v);
+		}
+		_mm_sfence();
+	}
+	for(; end - p >= 256; p += 256){
+		_mm512_store_si512(p + 0, v);
+		_mm512_store_si512(p + 64, v);
+		_mm512_store_si512(p + 128, v);
+		_mm512_store_si512(p + 192, v);
+	}
+	for(; end - p > 64; p += 64){
+		_mm512_store_si512(p, v);
+	}
+}
+
+static inline
+I32 mem_compare_at(U8 const* a, U8 const* b, U32 diff_mask){
+	U32 i = __builtin_ctz(diff_mask);
+	return a[i] < b[i] ? -1 : 1;
+}
+
+// n >= 16
+static
+I32 mem_compare_sse2(U8 const* a, U8 const* b, Size n){
+	Size i = 0;
+	for(; i + 16 <= n; i += 16){
+		__m128i x = _mm_loadu_si128((__m128i const*)(a + i));
+		__m128i y = _mm_loadu_si128((__m128i const*)(b + i));
+		U32 diff = ~(U32)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xffff;
+		if(diff != 0){ return mem_compare_at(a + i, b + i, diff); }
+	}
+	if(i < n){
+		i = n - 16;
+		__m128i x = _mm_loadu_si128((__m128i const*)(a + i));
+		__m128i y = _mm_loadu_si128((__m128i const*)(b + i));
+		U32 diff = ~(U32)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xffff;
+		if(diff != 0){ return mem_compare_at(a + i, b + i, diff); }
+	}
+	return 0;
+}
+
+// Index of the first differing byte in a 32 byte block
+__attribute__((target("avx2")))
+static inline
+U32 mem_diff_avx2(U8 const* a, U8 const* b){
+	__m256i x = _mm256_loadu_si256((__m256i const*)a);
+	__m256i y = _mm256_loadu_si256((__m256i const*)b);
+	return ~(U32)_mm256_movemask_epi8(_mm256_cmpeq_epi8(x, y));
+}
+
+// n >= 32
+__attribute__((target("avx2")))
+static
+I32 mem_compare_avx2(U8 const* a, U8 const* b, Size n){
+	Size i = 0;
+	if(n >= 1024){
+		// Align loads from `a`, so only half of them can split a cache line
+		U32 diff = mem_diff_avx2(a, b);
+		if(diff != 0){ return mem_compare_at(a, b, diff); }
+		i = 32 - ((Uintptr)a & 31);
+	}
+	// 128 bytes per iteration, only look for the differing byte once a block mismatches
+	for(; i + 128 <= n; i += 128){
+		__m256i eq = _mm256_and_si256(
+			_mm256_and_si256(
+				_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const*)(a + i)), _mm256_loadu_si256((__m256i const*)(b + i))),
+				_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const*)(a + i + 32)), _mm256_loadu_si256((__m256i const*)(b + i + 32)))),
+			_mm256_and_si256(
+				_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const*)(a + i + 64)), _mm256_loadu_si256((__m256i const*)(b + i + 64))),
+				_mm256_cmpeq_epi8(_mm256_loadu_si256((__m256i const*)(a + i + 96)), _mm256_loadu_si256((__m256i const*)(b + i + 96)))));
+		if((U32)_mm256_movemask_epi8(eq) != 0xffffffffu){
+			break;
+		}
+	}
+	for(; i + 32 <= n; i += 32){
+		U32 diff = mem_diff_avx2(a + i, b + i);
+		if(diff != 0){ return mem_compare_at(a + i, b + i, diff); }
+	}
+	if(i < n){
+		i = n - 32;
+		U32 diff = mem_diff_avx2(a + i, b + i);
+		if(diff != 0){ return mem_compare_at(a + i, b + i, diff); }
+	}
+	return 0;
+}
+#endif
+
+// Forward copy, only called with count > MEM_SMALL_SIZE
+static inline
+void mem_copy_forward(U8* d, U8 const* s, Size count, bool non_temporal){
+	switch(mem_cpu_level()){
+		#if defined(MEM_X86_KERNELS)
+		case MemLevel_AVX512: mem_copy_avx512(d, s, count, non_temporal); return;
+		case MemLevel_AVX2:   mem_copy_avx2(d, s, count, non_temporal); return;
+		case MemLevel_SSE2:   mem_copy_sse2(d, s, count, non_temporal); return;
+		#endif
+	}
+	(void)non_temporal;
+	mem_copy_impl(d, s, count);
+}
+
+void mem_copy_no_overlap_large(void* dest, void const * src, Size count){
+	mem_copy_forward(dest, src, count, count >= MEM_NON_TEMPORAL_THRESHOLD);
+}
+
+void mem_copy_large(void* dest, void const * src, Size count){
+	Uintptr d = (Uintptr)dest;
+	Uintptr s = (Uintptr)src;
+	if(d - s >= (Uintptr)count){
+		// dest is before src or past its end, forward copy is safe. Non-temporal
+		// stores are only used when the buffers don't overlap at all
+		bool disjoint = s - d >= (Uintptr)count;
+		mem_copy_forward(dest, src, count, disjoint && count >= MEM_NON_TEMPORAL_THRESHOLD);
+		return;
+	}
 	mem_copy_impl(dest, src, count);
 }
 
-void mem_copy_no_overlap(void* dest, void const * src, Size count){
-	mem_copy_no_overlap_impl(dest, src, count);
+void mem_set_large(void* p, U8 val, Size count){
+	switch(mem_cpu_level()){
+		#if defined(MEM_X86_KERNELS)
+		case MemLevel_AVX512: mem_set_avx512(p, val, count); return;
+		case MemLevel_AVX2:   mem_set_avx2(p, val, count); return;
+		case MemLevel_SSE2:   mem_set_sse2(p, val, count); return;
+		#endif
+	}
+	mem_set_impl(p, val, count);
 }
 
-I32 mem_compare(void const * a, void const * b, Size count){
-	return mem_compare_impl(a, b, count);
+I32 mem_compare_large(void const * a, void const * b, Size count){
+	switch(mem_cpu_level()){
+		#if defined(MEM_X86_KERNELS)
+		case MemLevel_AVX512:
+		case MemLevel_AVX2:
+			if(count >= 32){ return mem_compare_avx2(a, b, count); }
+			return mem_compare_sse2(a, b, count);
+		case MemLevel_SSE2:
+			return mem_compare_sse2(a, b, count);
+		#endif
+	}
+	I32 r = mem_compare_impl(a, b, count);
+	return (r > 0) - (r < 0);
 }
 
 
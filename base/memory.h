@@ -3,7 +3,7 @@
 
 #include "base.h"
 
-#define mem_new(Type, Num, Alloc) mem_alloc((Alloc), sizeof(Type) * (Num), alignof(Type));
+#define mem_new(Type, Num, Alloc) mem_alloc((Alloc), sizeof(Type) * (Num), alignof(Type))
 
 #define KiB (1024ll)
 #define MiB (1024ll * 1024ll)
@@ -12,19 +12,201 @@
 // Helper to use with printf "%.*s"
 #define fmt_str(buf) (int)((buf).len), (buf).v
 
+// Copies, sets and compares up to this size are done inline with a few
+// overlapping loads/stores, bigger ones go to the vectorized kernels in memory.c
+#define MEM_SMALL_SIZE 64
+
+// Copies and sets bigger than this use non-temporal stores, so they don't
+// evict the whole cache for data that won't be read back soon
+#ifndef MEM_NON_TEMPORAL_THRESHOLD
+#define MEM_NON_TEMPORAL_THRESHOLD (8 * MiB)
+#endif
+
+#if defined(__clang__) || defined(__GNUC__)
+#define mem_builtin_copy __builtin_memcpy
+#else
+#include <string.h>
+#define mem_builtin_copy memcpy
+#endif
+
+// Kernels for sizes above MEM_SMALL_SIZE, picked at runtime based on the CPU
+void mem_set_large(void* p, U8 val, Size count);
+void mem_copy_large(void* dest, void const * src, Size count);
+void mem_copy_no_overlap_large(void* dest, void const * src, Size count);
+I32  mem_compare_large(void const * a, void const * b, Size count);
+
+// GCC can't tell which size class a variable count falls in and warns about
+// the wider branches when inlined into small fixed size copies
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Warray-bounds"
+#pragma GCC diagnostic ignored "-Wstringop-overflow"
+#if __GNUC__ >= 11
+#pragma GCC diagnostic ignored "-Wstringop-overread"
+#endif
+#endif
+
+// Copy up to MEM_SMALL_SIZE bytes. Everything is loaded before anything is
+// stored, so overlapping buffers are fine
+static inline
+void mem_copy_small(U8* d, U8 const* s, Size n){
+	if(n >= 32){
+		U8 a[32], b[32];
+		mem_builtin_copy(a, s, 32);
+		mem_builtin_copy(b, s + n - 32, 32);
+		mem_builtin_copy(d, a, 32);
+		mem_builtin_copy(d + n - 32, b, 32);
+	}
+	else if(n >= 16){
+		U8 a[16], b[16];
+		mem_builtin_copy(a, s, 16);
+		mem_builtin_copy(b, s + n - 16, 16);
+		mem_builtin_copy(d, a, 16);
+		mem_builtin_copy(d + n - 16, b, 16);
+	}
+	else if(n >= 8){
+		U64 a, b;
+		mem_builtin_copy(&a, s, 8);
+		mem_builtin_copy(&b, s + n - 8, 8);
+		mem_builtin_copy(d, &a, 8);
+		mem_builtin_copy(d + n - 8, &b, 8);
+	}
+	else if(n >= 4){
+		U32 a, b;
+		mem_builtin_copy(&a, s, 4);
+		mem_builtin_copy(&b, s + n - 4, 4);
+		mem_builtin_copy(d, &a, 4);
+		mem_builtin_copy(d + n - 4, &b, 4);
+	}
+	else if(n > 0){
+		U8 a = s[0], b = s[n / 2], c = s[n - 1];
+		d[0] = a;
+		d[n / 2] = b;
+		d[n - 1] = c;
+	}
+}
+
 // Set n U8s of p to value.
-void mem_set(void* p, U8 val, Size count);
+static inline
+void mem_set(void* p, U8 val, Size count){
+	if(hint_unlikely(count > MEM_SMALL_SIZE)){
+		mem_set_large(p, val, count);
+		return;
+	}
+	U8* d = p;
+	U64 v = 0x0101010101010101ull * val;
+	if(count >= 32){
+		U64 w[4] = {v, v, v, v};
+		mem_builtin_copy(d, w, 32);
+		mem_builtin_copy(d + count - 32, w, 32);
+	}
+	else if(count >= 16){
+		U64 w[2] = {v, v};
+		mem_builtin_copy(d, w, 16);
+		mem_builtin_copy(d + count - 16, w, 16);
+	}
+	else if(count >= 8){
+		mem_builtin_copy(d, &v, 8);
+		mem_builtin_copy(d + count - 8, &v, 8);
+	}
+	else if(count >= 4){
+		mem_builtin_copy(d, &v, 4);
+		mem_builtin_copy(d + count - 4, &v, 4);
+	}
+	else if(count > 0){
+		d[0] = val;
+		d[count / 2] = val;
+		d[count - 1] = val;
+	}
+}
 
 // Copy n U8s for source to destination, they may overlap.
-void mem_copy(void* dest, void const * src, Size count);
-
-// Compare 2 buffers of memory, returns -1, 0, 1 depending on which buffer shows
-// a bigger U8 first, 0 meaning equality.
-I32 mem_compare(void const * a, void const * b, Size count);
+static inline
+void mem_copy(void* dest, void const * src, Size count){
+	if(hint_unlikely(count > MEM_SMALL_SIZE)){
+		mem_copy_large(dest, src, count);
+		return;
+	}
+	mem_copy_small(dest, src, count);
+}
 
 // Copy n U8s for source to destination, they should not overlap, this tends
 // to be faster then mem_copy
-void mem_copy_no_overlap(void* dest, void const * src, Size count);
+static inline
+void mem_copy_no_overlap(void* dest, void const * src, Size count){
+	if(hint_unlikely(count > MEM_SMALL_SIZE)){
+		mem_copy_no_overlap_large(dest, src, count);
+		return;
+	}
+	mem_copy_small(dest, src, count);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define MEM_COMPARE_WORDS
+// Compare the 8 byte words at a and b, returns -1, 0, 1 like mem_compare
+static inline
+I32 mem_compare_word(U8 const* a, U8 const* b){
+	U64 x, y;
+	mem_builtin_copy(&x, a, 8);
+	mem_builtin_copy(&y, b, 8);
+	if(x == y){ return 0; }
+	Size i = __builtin_ctzll(x ^ y) / 8; /* First differing byte */
+	return a[i] < b[i] ? -1 : 1;
+}
+#endif
+
+#if defined(__SSE2__) && (defined(__clang__) || defined(__GNUC__))
+#include <emmintrin.h>
+#define MEM_COMPARE_SSE2
+// Bit mask of the differing bytes in a 16 byte block
+static inline
+U32 mem_diff_sse2(U8 const* a, U8 const* b){
+	__m128i x = _mm_loadu_si128((__m128i const*)a);
+	__m128i y = _mm_loadu_si128((__m128i const*)b);
+	return ~(U32)_mm_movemask_epi8(_mm_cmpeq_epi8(x, y)) & 0xffff;
+}
+#endif
+
+// Compare 2 buffers of memory, returns -1, 0, 1 depending on which buffer shows
+// a bigger U8 first, 0 meaning equality.
+static inline
+I32 mem_compare(void const * a, void const * b, Size count){
+	U8 const* x = a;
+	U8 const* y = b;
+	#if defined(MEM_COMPARE_WORDS)
+	if(count >= 8 && count <= 16){
+		I32 r = mem_compare_word(x, y);
+		return r != 0 ? r : mem_compare_word(x + count - 8, y + count - 8);
+	}
+	#endif
+	#if defined(MEM_COMPARE_SSE2)
+	if(count > 16 && count <= MEM_SMALL_SIZE){
+		// Four overlapping 16 byte blocks covering [0, count). Blocks are in
+		// address order, so the lowest set bit is the first differing byte
+		Size last = count - 16;
+		Size offsets[4] = { 0, min(16, last), min(32, last), last };
+		U64 mask = (U64)mem_diff_sse2(x, y)
+			| ((U64)mem_diff_sse2(x + offsets[1], y + offsets[1]) << 16)
+			| ((U64)mem_diff_sse2(x + offsets[2], y + offsets[2]) << 32)
+			| ((U64)mem_diff_sse2(x + last, y + last) << 48);
+		if(mask == 0){ return 0; }
+		U32 bit = __builtin_ctzll(mask);
+		Size i = offsets[bit / 16] + bit % 16;
+		return x[i] < y[i] ? -1 : 1;
+	}
+	#endif
+	if(count < 8){
+		for(Size i = 0; i < count; i += 1){
+			if(x[i] != y[i]){ return x[i] < y[i] ? -1 : 1; }
+		}
+		return 0;
+	}
+	return mem_compare_large(a, b, count);
+}
 
 static inline
 bool mem_valid_alignment(Size align){
@@ -0,0 +1,89 @@
+#include "pool.h"
+#include "memory.h"
+
+bool pool_init(Pool* p, Arena* arena, Size slot_size, Size align){
+	if(slot_size <= 0 || !mem_valid_alignment(align)){ return false; }
+	mem_set(p, 0, sizeof(*p));
+	p->arena = arena;
+	p->slot_align = max(align, (Size)alignof(PoolSlot));
+	p->slot_size = align_forward_size(max(slot_size, (Size)sizeof(PoolSlot)), p->slot_align);
+	p->chunk_slots = max(POOL_CHUNK_SIZE / p->slot_size, POOL_MIN_CHUNK_SLOTS);
+	return true;
+}
+
+static inline
+U8* pool_chunk_slots(Pool* p, PoolChunk* chunk){
+	return (U8*)chunk + align_forward_size(sizeof(PoolChunk), p->slot_align);
+}
+
+static
+bool pool_next_chunk(Pool* p){
+	// Reuse chunks left over from a previous pool_free_all
+	if(p->current_chunk != NULL && p->current_chunk->next != NULL){
+		p->current_chunk = p->current_chunk->next;
+		p->chunk_used = 0;
+		return true;
+	}
+
+	Size header = align_forward_size(sizeof(PoolChunk), p->slot_align);
+	Size align = max(p->slot_align, (Size)alignof(PoolChunk));
+	PoolChunk* chunk = arena_alloc(p->arena, header + p->chunk_slots * p->slot_size, align);
+	if(chunk == NULL){
+		return false;
+	}
+
+	chunk->next = NULL;
+	if(p->current_chunk != NULL){
+		p->current_chunk->next = chunk;
+	}
+	else {
+		p->chunks = chunk;
+	}
+	p->current_chunk = chunk;
+	p->chunk_used = 0;
+	return true;
+}
+
+void* pool_alloc(Pool* p){
+	PoolSlot* slot = p->free_list;
+
+	if(slot != NULL){
+		p->free_list = slot->next;
+		#if defined(POOL_DEBUG)
+		U8 const* bytes = (U8 const*)slot;
+		for(Size i = sizeof(PoolSlot); i < p->slot_size; i += 1){
+			ensure(bytes[i] == POOL_POISON_BYTE, "Pool slot was written to after being freed");
+		}
+		#endif
+	}
+	else {
+		if(hint_unlikely(p->current_chunk == NULL || p->chunk_used >= p->chunk_slots)){
+			if(!pool_next_chunk(p)){
+				return NULL; /* Out of memory */
+			}
+		}
+		slot = (PoolSlot*)(pool_chunk_slots(p, p->current_chunk) + p->chunk_used * p->slot_size);
+		p->chunk_used += 1;
+	}
+
+	p->in_use += 1;
+	return slot;
+}
+
+void pool_free(Pool* p, void* ptr){
+	if(ptr == NULL){ return; }
+	#if defined(POOL_DEBUG)
+	mem_set(ptr, POOL_POISON_BYTE, p->slot_size);
+	#endif
+	PoolSlot* slot = ptr;
+	slot->next = p->free_list;
+	p->free_list = slot;
+	p->in_use -= 1;
+}
+
+void pool_free_all(Pool* p){
+	p->free_list = NULL;
+	p->current_chunk = p->chunks;
+	p->chunk_used = 0;
+	p->in_use = 0;
+}
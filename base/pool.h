@@ -0,0 +1,56 @@
+#ifndef _pool_h_include_
+#define _pool_h_include_
+
+#include "base.h"
+#include "arena.h"
+
+// Target size of each chunk of slots requested from the backing arena
+#define POOL_CHUNK_SIZE (16 * KiB)
+#define POOL_MIN_CHUNK_SLOTS 8
+
+// Byte used to fill freed slots when POOL_DEBUG is defined
+#define POOL_POISON_BYTE 0xdd
+
+typedef struct Pool Pool;
+typedef struct PoolSlot PoolSlot;
+typedef struct PoolChunk PoolChunk;
+
+struct PoolSlot {
+	PoolSlot* next;
+};
+
+struct PoolChunk {
+	PoolChunk* next;
+};
+
+// Fixed size object allocator. Slots are carved from chunks allocated from an
+// arena and recycled through an intrusive free list. Not thread safe, use one
+// pool per thread.
+struct Pool {
+	Arena*     arena;
+	PoolSlot*  free_list;
+	PoolChunk* chunks;        // All chunks owned by pool
+	PoolChunk* current_chunk; // Chunk being carved
+	Size       chunk_used;    // Slots already carved from current chunk
+	Size       chunk_slots;   // Slots per chunk
+	Size       slot_size;
+	Size       slot_align;
+	Size       in_use;
+};
+
+// Helper macro
+#define pool_new(P, Type) ((Type *)pool_alloc(P))
+
+// Initialize a pool of `slot_size` objects aligned to `align`, backed by arena
+bool pool_init(Pool* p, Arena* arena, Size slot_size, Size align);
+
+// Get a slot from pool, return null on failure
+void* pool_alloc(Pool* p);
+
+// Give slot back to pool
+void pool_free(Pool* p, void* ptr);
+
+// Mark all slots as free, chunks are kept for reuse
+void pool_free_all(Pool* p);
+
+#endif /* Include guard */
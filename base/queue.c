@@ -0,0 +1,223 @@
+#include "queue.h"
+#include "memory.h"
+
+static inline
+Size queue_capacity(Size capacity){
+	Size cap = 2;
+	while(cap < capacity){ cap *= 2; }
+	return cap;
+}
+
+// Waking is skipped when nobody sleeps, waiters re-check the queue after
+// registering so either side is guaranteed to see the other.
+static inline
+void queue_event_signal(QueueEvent* e){
+	atomic_thread_fence(memory_order_seq_cst);
+	if(atomic_load_explicit(&e->waiters, memory_order_relaxed) > 0){
+		atomic_fetch_add(&e->seq, 1);
+		futex_wake_one(&e->seq);
+	}
+}
+
+static inline
+U32 queue_event_prepare(QueueEvent* e){
+	U32 seen = atomic_load(&e->seq);
+	atomic_fetch_add(&e->waiters, 1);
+	atomic_thread_fence(memory_order_seq_cst);
+	return seen;
+}
+
+static inline
+void queue_event_cancel(QueueEvent* e){
+	atomic_fetch_sub(&e->waiters, 1);
+}
+
+static inline
+void queue_event_sleep(QueueEvent* e, U32 seen){
+	futex_wait(&e->seq, seen);
+	atomic_fetch_sub(&e->waiters, 1);
+}
+
+/* SPSC */
+bool spsc_queue_init(SpscQueue* q, Arena* arena, Size capacity){
+	if(capacity <= 0){ return false; }
+	mem_set(q, 0, sizeof(*q));
+	Size cap = queue_capacity(capacity);
+	q->items = arena_push(arena, void*, cap);
+	if(q->items == NULL){ return false; }
+	q->mask = cap - 1;
+	return true;
+}
+
+bool spsc_queue_push(SpscQueue* q, void* item){
+	Size tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+	if(tail - q->cached_head > q->mask){
+		q->cached_head = atomic_load_explicit(&q->head, memory_order_acquire);
+		if(tail - q->cached_head > q->mask){
+			return false; /* Full */
+		}
+	}
+	q->items[tail & q->mask] = item;
+	atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+	queue_event_signal(&q->not_empty);
+	return true;
+}
+
+bool spsc_queue_pop(SpscQueue* q, void** out){
+	Size head = atomic_load_explicit(&q->head, memory_order_relaxed);
+	if(head == q->cached_tail){
+		q->cached_tail = atomic_load_explicit(&q->tail, memory_order_acquire);
+		if(head == q->cached_tail){
+			return false; /* Empty */
+		}
+	}
+	*out = q->items[head & q->mask];
+	atomic_store_explicit(&q->head, head + 1, memory_order_release);
+	queue_event_signal(&q->not_full);
+	return true;
+}
+
+void spsc_queue_push_wait(SpscQueue* q, void* item){
+	for(I32 spin = 0; !spsc_queue_push(q, item); spin += 1){
+		if(spin < QUEUE_SPIN_COUNT){
+			cpu_relax();
+			continue;
+		}
+		U32 seen = queue_event_prepare(&q->not_full);
+		if(spsc_queue_push(q, item)){
+			queue_event_cancel(&q->not_full);
+			break;
+		}
+		queue_event_sleep(&q->not_full, seen);
+	}
+}
+
+void* spsc_queue_pop_wait(SpscQueue* q){
+	void* item = NULL;
+	for(I32 spin = 0; !spsc_queue_pop(q, &item); spin += 1){
+		if(spin < QUEUE_SPIN_COUNT){
+			cpu_relax();
+			continue;
+		}
+		U32 seen = queue_event_prepare(&q->not_empty);
+		if(spsc_queue_pop(q, &item)){
+			queue_event_cancel(&q->not_empty);
+			break;
+		}
+		queue_event_sleep(&q->not_empty, seen);
+	}
+	return item;
+}
+
+/* MPMC */
+bool mpmc_queue_init(MpmcQueue* q, Arena* arena, Size capacity){
+	if(capacity <= 0){ return false; }
+	mem_set(q, 0, sizeof(*q));
+	Size cap = queue_capacity(capacity);
+	q->cells = arena_push(arena, MpmcCell, cap);
+	if(q->cells == NULL){ return false; }
+	for(Size i = 0; i < cap; i += 1){
+		atomic_store_explicit(&q->cells[i].sequence, i, memory_order_relaxed);
+	}
+	q->mask = cap - 1;
+	return true;
+}
+
+bool mpmc_queue_push(MpmcQueue* q, void* item){
+	Size pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+	MpmcCell* cell = NULL;
+	while(1){
+		cell = &q->cells[pos & q->mask];
+		Size seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+		Size diff = seq - pos;
+		if(diff == 0){
+			if(atomic_compare_exchange_weak_explicit(&q->enqueue_pos, &pos, pos + 1,
+				memory_order_relaxed, memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if(diff < 0){
+			// The cell is either still holding an item, or a pop claimed it and
+			// hasn't released it yet. Only the first case means the queue is full
+			Size dequeue = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+			if(pos - dequeue > (Size)q->mask){
+				return false; /* Full */
+			}
+			cpu_relax();
+			pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+		}
+		else {
+			pos = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+		}
+	}
+	cell->data = item;
+	atomic_store_explicit(&cell->sequence, pos + 1, memory_order_release);
+	queue_event_signal(&q->not_empty);
+	return true;
+}
+
+bool mpmc_queue_pop(MpmcQueue* q, void** out){
+	Size pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+	MpmcCell* cell = NULL;
+	while(1){
+		cell = &q->cells[pos & q->mask];
+		Size seq = atomic_load_explicit(&cell->sequence, memory_order_acquire);
+		Size diff = seq - (pos + 1);
+		if(diff == 0){
+			if(atomic_compare_exchange_weak_explicit(&q->dequeue_pos, &pos, pos + 1,
+				memory_order_relaxed, memory_order_relaxed))
+			{
+				break;
+			}
+		}
+		else if(diff < 0){
+			// Same for a push that claimed the cell but hasn't published its item
+			Size enqueue = atomic_load_explicit(&q->enqueue_pos, memory_order_relaxed);
+			if(enqueue == pos){
+				return false; /* Empty */
+			}
+			cpu_relax();
+			pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+		}
+		else {
+			pos = atomic_load_explicit(&q->dequeue_pos, memory_order_relaxed);
+		}
+	}
+	*out = cell->data;
+	atomic_store_explicit(&cell->sequence, pos + q->mask + 1, memory_order_release);
+	queue_event_signal(&q->not_full);
+	return true;
+}
+
+void mpmc_queue_push_wait(MpmcQueue* q, void* item){
+	for(I32 spin = 0; !mpmc_queue_push(q, item); spin += 1){
+		if(spin < QUEUE_SPIN_COUNT){
+			cpu_relax();
+			continue;
+		}
+		U32 seen = queue_event_prepare(&q->not_full);
+		if(mpmc_queue_push(q, item)){
+			queue_event_cancel(&q->not_full);
+			break;
+		}
+		queue_event_sleep(&q->not_full, seen);
+	}
+}
+
+void* mpmc_queue_pop_wait(MpmcQueue* q){
+	void* item = NULL;
+	for(I32 spin = 0; !mpmc_queue_pop(q, &item); spin += 1){
+		if(spin < QUEUE_SPIN_COUNT){
+			cpu_relax();
+			continue;
+		}
+		U32 seen = queue_event_prepare(&q->not_empty);
+		if(mpmc_queue_pop(q, &item)){
+			queue_event_cancel(&q->not_empty);
+			break;
+		}
+		queue_event_sleep(&q->not_empty, seen);
+	}
+	return item;
+}
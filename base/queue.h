@@ -0,0 +1,84 @@
+#ifndef _queue_h_include_
+#define _queue_h_include_
+
+#include "base.h"
+#include "arena.h"
+#include "thread.h"
+
+// Bounded lock-free queues of pointers. Capacity is rounded up to a power of 2.
+// The *_wait variants spin for a while and then sleep on a futex, pushes only
+// make a syscall when someone is sleeping.
+
+#define QUEUE_SPIN_COUNT 128
+
+typedef struct QueueEvent QueueEvent;
+typedef struct SpscQueue SpscQueue;
+typedef struct MpmcQueue MpmcQueue;
+typedef struct MpmcCell MpmcCell;
+
+// Futex based event, sleepers wait for `seq` to change
+struct QueueEvent {
+	AtomicU32 seq;
+	AtomicU32 waiters;
+};
+
+// Single producer, single consumer ring
+struct SpscQueue {
+	alignas(CACHE_LINE_SIZE) AtomicSize head; // Next slot to read, written by consumer
+	Size cached_tail;
+	QueueEvent not_full;
+	alignas(CACHE_LINE_SIZE) AtomicSize tail; // Next slot to write, written by producer
+	Size cached_head;
+	QueueEvent not_empty;
+	alignas(CACHE_LINE_SIZE) void** items;
+	Size mask;
+};
+
+struct MpmcCell {
+	AtomicSize sequence;
+	void* data;
+};
+
+// Multi producer, multi consumer queue (Dmitry Vyukov's bounded queue)
+struct MpmcQueue {
+	alignas(CACHE_LINE_SIZE) AtomicSize enqueue_pos;
+	QueueEvent not_full;
+	alignas(CACHE_LINE_SIZE) AtomicSize dequeue_pos;
+	QueueEvent not_empty;
+	alignas(CACHE_LINE_SIZE) MpmcCell* cells;
+	Size mask;
+};
+
+// Initialize queue holding up to `capacity` items, returns success status
+bool spsc_queue_init(SpscQueue* q, Arena* arena, Size capacity);
+
+// Push item, returns false if queue is full
+bool spsc_queue_push(SpscQueue* q, void* item);
+
+// Pop item into out, returns false if queue is empty
+bool spsc_queue_pop(SpscQueue* q, void** out);
+
+// Push item, blocking while queue is full
+void spsc_queue_push_wait(SpscQueue* q, void* item);
+
+// Pop item, blocking while queue is empty
+void* spsc_queue_pop_wait(SpscQueue* q);
+
+// Initialize queue holding up to `capacity` items, returns success status
+bool mpmc_queue_init(MpmcQueue* q, Arena* arena, Size capacity);
+
+// Push item, returns false if queue is full. Pops still in flight are waited
+// out, so false always means every cell holds an item
+bool mpmc_queue_push(MpmcQueue* q, void* item);
+
+// Pop item into out, returns false if queue is empty. Pushes still in flight
+// are waited out, so false always means no push has claimed a cell
+bool mpmc_queue_pop(MpmcQueue* q, void** out);
+
+// Push item, blocking while queue is full
+void mpmc_queue_push_wait(MpmcQueue* q, void* item);
+
+// Pop item, blocking while queue is empty
+void* mpmc_queue_pop_wait(MpmcQueue* q);
+
+#endif /* Include guard */
@@ -0,0 +1,114 @@
+#include "string_builder.h"
+#include "strings.h"
+#include "allocator.h"
+
+// Grow `data` to hold at least `needed` elements of `elem_size`, in place when possible
+static
+bool string_builder_grow(StringBuilder* sb, Size needed, Size elem_size, Size align){
+	if(needed <= sb->cap){
+		return true;
+	}
+	Size new_cap = max(max(sb->cap * 2, needed), (Size)STRING_BUILDER_MIN_CAP);
+	// arena_realloc tries arena_resize first, only moving the data when
+	// something else was allocated after it
+	void* data = arena_realloc(sb->arena, sb->data, sb->cap * elem_size, new_cap * elem_size, align);
+	if(data == NULL){
+		return false;
+	}
+	sb->data = data;
+	sb->cap = new_cap;
+	return true;
+}
+
+bool string_builder_init_buffer(StringBuilder* sb, Arena* arena, Size initial_cap){
+	*sb = (StringBuilder){
+		.arena = arena,
+		.kind = StringBuilderKind_Buffer,
+	};
+	return string_builder_grow(sb, initial_cap, 1, 1);
+}
+
+bool string_builder_init_rope(StringBuilder* sb, Arena* arena){
+	*sb = (StringBuilder){
+		.arena = arena,
+		.kind = StringBuilderKind_Rope,
+	};
+	return string_builder_grow(sb, 1, sizeof(String), alignof(String));
+}
+
+bool string_builder_append(StringBuilder* sb, String s){
+	if(s.len <= 0){
+		return true;
+	}
+
+	if(sb->kind == StringBuilderKind_Rope){
+		String* segments = (String*)sb->data;
+		// Extend last segment if the new one is right after it in memory
+		if(sb->len > 0 && segments[sb->len - 1].v + segments[sb->len - 1].len == s.v){
+			segments[sb->len - 1].len += s.len;
+			sb->byte_len += s.len;
+			return true;
+		}
+		if(!string_builder_grow(sb, sb->len + 1, sizeof(String), alignof(String))){
+			return false;
+		}
+		((String*)sb->data)[sb->len] = s;
+		sb->len += 1;
+		sb->byte_len += s.len;
+		return true;
+	}
+
+	if(!string_builder_grow(sb, sb->len + s.len, 1, 1)){
+		return false;
+	}
+	mem_copy_no_overlap(&sb->data[sb->len], s.v, s.len);
+	sb->len += s.len;
+	sb->byte_len = sb->len;
+	return true;
+}
+
+bool string_builder_append_rune(StringBuilder* sb, Rune r){
+	UTF8Encode enc = utf8_encode(r);
+	if(enc.len <= 0){ return false; }
+	String s = str_from_bytes(enc.bytes, enc.len);
+	if(sb->kind == StringBuilderKind_Rope){
+		s = str_clone(s, arena_allocator(sb->arena));
+		if(s.v == NULL){ return false; }
+	}
+	return string_builder_append(sb, s);
+}
+
+String string_builder_build(StringBuilder* sb){
+	if(sb->kind == StringBuilderKind_Buffer){
+		return str_from_bytes(sb->data, sb->len);
+	}
+
+	U8* buf = arena_alloc(sb->arena, max(sb->byte_len, 1), 1);
+	if(buf == NULL){
+		return (String){0};
+	}
+	String const* segments = (String const*)sb->data;
+	Size offset = 0;
+	for(Size i = 0; i < sb->len; i += 1){
+		mem_copy_no_overlap(&buf[offset], segments[i].v, segments[i].len);
+		offset += segments[i].len;
+	}
+
+	// The flat copy is the last allocation, so further appends can grow it in place
+	sb->kind = StringBuilderKind_Buffer;
+	sb->data = buf;
+	sb->len = sb->cap = sb->byte_len;
+	return str_from_bytes(buf, sb->len);
+}
+
+bool string_builder_write(StringBuilder const* sb, FileWriter* w){
+	if(sb->kind == StringBuilderKind_Rope){
+		return file_writer_write_many(w, (String const*)sb->data, sb->len);
+	}
+	return file_writer_write(w, str_from_bytes(sb->data, sb->len));
+}
+
+void string_builder_reset(StringBuilder* sb){
+	sb->len = 0;
+	sb->byte_len = 0;
+}
@@ -0,0 +1,56 @@
+#ifndef _string_builder_h_include_
+#define _string_builder_h_include_
+
+#include "base.h"
+#include "arena.h"
+#include "filesystem.h"
+
+typedef struct StringBuilder StringBuilder;
+
+typedef enum StringBuilderKind StringBuilderKind;
+
+enum StringBuilderKind {
+	StringBuilderKind_Buffer = 0, // Appends are copied into one contiguous buffer
+	StringBuilderKind_Rope = 1,   // Appends are recorded as segments, nothing is copied until the end
+};
+
+#define STRING_BUILDER_MIN_CAP 64
+
+// Incremental string building on top of an arena. In buffer mode the buffer
+// grows in place while it's the arena's last allocation, so appending n bytes
+// is amortized O(n). In rope mode the appended strings must outlive the
+// builder, they're only copied by string_builder_build, or never if the
+// result goes straight to string_builder_write.
+struct StringBuilder {
+	Arena* arena;
+	U8* data;      // Buffer: bytes. Rope: String segments
+	Size len;      // Buffer: bytes used. Rope: segments used
+	Size cap;
+	Size byte_len; // Total length of the string being built
+	U8 kind;
+};
+
+// Initialize buffer mode builder with `initial_cap` bytes reserved
+bool string_builder_init_buffer(StringBuilder* sb, Arena* arena, Size initial_cap);
+
+// Initialize rope mode builder
+bool string_builder_init_rope(StringBuilder* sb, Arena* arena);
+
+// Append string, returns false on allocation failure
+bool string_builder_append(StringBuilder* sb, String s);
+
+// Append UTF-8 encoded codepoint, in rope mode the bytes are copied into the arena
+bool string_builder_append_rune(StringBuilder* sb, Rune r);
+
+// Get the built string. Rope segments are flattened into a single arena
+// allocation, after which the builder continues in buffer mode. Returns an
+// empty string on allocation failure
+String string_builder_build(StringBuilder* sb);
+
+// Write the built string, rope segments are sent without being concatenated
+bool string_builder_write(StringBuilder const* sb, FileWriter* w);
+
+// Drop contents, keeps kind and memory
+void string_builder_reset(StringBuilder* sb);
+
+#endif /* Include guard */
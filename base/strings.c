@@ -1,8 +1,12 @@
 #include "base.h"
 #include "memory.h"
-#include "arena.h"
+#include "allocator.h"
 #include "strings.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #define UTF8_RANGE1 ((I32)0x7f)
 #define UTF8_RANGE2 ((I32)0x7ff)
 #define UTF8_RANGE3 ((I32)0xffff)
@@ -237,9 +241,9 @@ bool str_eq(String a, String b){
 	return true;
 }
 
-String str_clone(String c, Arena* arena){
+String str_clone(String c, Allocator allocator){
 	String res = {0};
-	U8* new_buf = arena_push(arena, U8, c.len + 1);
+	U8* new_buf = mem_new(U8, c.len + 1, allocator);
 	if(new_buf != NULL){
 		mem_copy_no_overlap(new_buf, c.v, c.len);
 		new_buf[c.len] = 0;
@@ -249,6 +253,19 @@ String str_clone(String c, Arena* arena){
 	return res;
 }
 
+String str_concat(String a, String b, Allocator allocator){
+	String res = {0};
+	U8* new_buf = mem_new(U8, a.len + b.len + 1, allocator);
+	if(new_buf != NULL){
+		mem_copy_no_overlap(new_buf, a.v, a.len);
+		mem_copy_no_overlap(new_buf + a.len, b.v, b.len);
+		new_buf[a.len + b.len] = 0;
+		res.len = a.len + b.len;
+		res.v = new_buf;
+	}
+	return res;
+}
+
 UTF8Iterator str_iterator(String s){
 	return (UTF8Iterator){
 		.current = 0,
@@ -362,6 +379,77 @@ String str_trim_trailing(String s, String cutset){
 	return str_sub(s, 0, cut_until);
 }
 
+Size str_count_newlines(String s){
+	Size count = 0;
+	Size i = 0;
+	#if defined(__SSE2__)
+	__m128i newline = _mm_set1_epi8('\n');
+	for(; i + 16 <= s.len; i += 16){
+		__m128i chunk = _mm_loadu_si128((__m128i const*)&s.v[i]);
+		U32 mask = (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+		count += __builtin_popcount(mask);
+	}
+	#endif
+	for(; i < s.len; i += 1){
+		count += s.v[i] == '\n';
+	}
+	return count;
+}
+
+bool line_index_build(LineIndex* index, String s, Allocator allocator){
+	Size line_count = str_count_newlines(s) + 1;
+	Size* starts = mem_new(Size, line_count, allocator);
+	if(starts == NULL){ return false; }
+
+	Size n = 0;
+	starts[n++] = 0;
+
+	Size i = 0;
+	#if defined(__SSE2__)
+	__m128i newline = _mm_set1_epi8('\n');
+	for(; i + 16 <= s.len; i += 16){
+		__m128i chunk = _mm_loadu_si128((__m128i const*)&s.v[i]);
+		U32 mask = (U32)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+		while(mask != 0){
+			starts[n++] = i + __builtin_ctz(mask) + 1;
+			mask &= mask - 1;
+		}
+	}
+	#endif
+	for(; i < s.len; i += 1){
+		if(s.v[i] == '\n'){
+			starts[n++] = i + 1;
+		}
+	}
+
+	index->starts = starts;
+	index->len = n;
+	return true;
+}
+
+SourceLocation line_index_locate(LineIndex const* index, String s, Size offset){
+	offset = clamp(0, offset, s.len);
+
+	// Last line starting at or before offset
+	Size lo = 0, hi = index->len - 1;
+	while(lo < hi){
+		Size mid = lo + (hi - lo + 1) / 2;
+		if(index->starts[mid] <= offset){
+			lo = mid;
+		}
+		else {
+			hi = mid - 1;
+		}
+	}
+
+	Size line_start = index->starts[lo];
+	String prefix = str_sub(s, line_start, offset - line_start);
+	return (SourceLocation){
+		.line = lo + 1,
+		.column = str_codepoint_count(prefix) + 1,
+	};
+}
+
 #undef UTF8_RANGE1
 #undef UTF8_RANGE2
 #undef UTF8_RANGE3
@@ -2,11 +2,13 @@
 #define _strings_h_include_
 
 #include "base.h"
-#include "arena.h"
+#include "allocator.h"
 
 typedef struct UTF8Encode UTF8Encode;
 typedef struct UTF8Decode UTF8Decode;
 typedef struct UTF8Iterator UTF8Iterator;
+typedef struct LineIndex LineIndex;
+typedef struct SourceLocation SourceLocation;
 
 // UTF-8 encoding result, a len = 0 means an error.
 struct UTF8Encode {
@@ -79,10 +81,10 @@ Size str_codepoint_count(String s);
 Size str_codepoint_offset(String s, Size n);
 
 // Clone a string
-String str_clone(String s, Arena* a);
+String str_clone(String s, Allocator allocator);
 
 // Concatenate 2 strings
-// String str_concat(String a, String b, Mem_Allocator allocator);
+String str_concat(String a, String b, Allocator allocator);
 
 // Check if 2 strings are equal
 bool str_eq(String a, String b);
@@ -111,5 +113,26 @@ UTF8Iterator str_iterator_reversed(String s);
 // Is string empty?
 bool str_empty(String s);
 
+// Byte offsets of the start of every line in a string
+struct LineIndex {
+	Size* starts;
+	Size  len;
+};
+
+// 1 based line and column, column is counted in codepoints
+struct SourceLocation {
+	Size line;
+	Size column;
+};
+
+// Count '\n' bytes in string
+Size str_count_newlines(String s);
+
+// Build line index of string, returns false on allocation failure
+bool line_index_build(LineIndex* index, String s, Allocator allocator);
+
+// Map byte offset of string to line and column
+SourceLocation line_index_locate(LineIndex const* index, String s, Size offset);
+
 
 #endif /* Include guard */
@@ -0,0 +1,645 @@
+// Build with optimizations, e.g.:
+//   cc -O2 -std=c17 -DTARGET_OS_LINUX base/tests/bench.c base/base.c lexer.c ondemand.c query.c tape.c schema.c doc_cache.c -o bench -lpthread
+// Pass --csv for machine readable output:
+//   name,bytes_per_run,runs,median_ns,p99_ns,bytes_per_sec
+#include "../base.h"
+#include "../memory.h"
+#include "../arena.h"
+#include "../arena_pool.h"
+#include "../strings.h"
+#include "../allocator.h"
+#include "../dynamic_array.h"
+#include "../string_builder.h"
+#include "../hash.h"
+#include "../timing.h"
+#include "../../lexer.h"
+#include "../../ondemand.h"
+#include "../../query.h"
+#include "../../tape.h"
+#include "../../schema.h"
+#include "../../doc_cache.h"
+#include <stdio.h>
+#include <string.h>
+#include "bench.h"
+
+static const Size CORPUS_SIZES[] = { 1 * KiB, 64 * KiB, 4 * MiB };
+#define CORPUS_SIZE_COUNT (Size)(sizeof(CORPUS_SIZES) / sizeof(CORPUS_SIZES[0]))
+
+static U64 bench_rng_state = 0x2545f4914f6cdd1dull;
+
+static inline
+U32 bench_rand(){
+    bench_rng_state = bench_rng_state * 6364136223846793005ull + 1442695040888963407ull;
+    return (U32)(bench_rng_state >> 33);
+}
+
+static
+String make_utf8_corpus(Arena* arena, Size size){
+    static const Rune samples[] = { 'a', 'Z', ' ', 0xe9, 0x3b1, 0x4e2d, 0x1f600 };
+    U8* buf = arena_push(arena, U8, size);
+    Size len = 0;
+    while(1){
+        UTF8Encode enc = utf8_encode(samples[bench_rand() % 7]);
+        if(len + enc.len > size){ break; }
+        mem_copy_no_overlap(&buf[len], enc.bytes, enc.len);
+        len += enc.len;
+    }
+    return str_from_bytes(buf, len);
+}
+
+static
+String make_json_corpus(Arena* arena, Size size){
+    static const char* const pieces[] = {
+        "{ \"id\": 1234, ", "\"name\": \"some name\", ", "\"score\": -12.5e3, ",
+        "\"tags\": [\"a\", \"b\", \"c\"], ", "\"ok\": true, ", "\"parent\": nil, ",
+        "// comment\n", "\"nested\": { \"x\": 1, \"y\": 2 } }, \n",
+    };
+    U8* buf = arena_push(arena, U8, size);
+    Size len = 0;
+    while(1){
+        String p = str_from(pieces[bench_rand() % 8]);
+        if(len + p.len > size){ break; }
+        mem_copy_no_overlap(&buf[len], p.v, p.len);
+        len += p.len;
+    }
+    return str_from_bytes(buf, len);
+}
+
+static
+void bench_arena_alloc(Arena* scratch){
+    (void)scratch;
+    enum { COUNT = 100000, ALLOC_SIZE = 24 };
+    Arena arena = {0};
+    arena_init_virtual(&arena, 64 * MiB);
+
+    {
+        BENCH_BEGIN("arena_alloc/24B", COUNT * ALLOC_SIZE);
+        BENCH_LOOP {
+            arena_free_all(&arena);
+            for(Size i = 0; i < COUNT; i += 1){
+                bench_sink += (Uintptr)arena_alloc(&arena, ALLOC_SIZE, 8);
+            }
+        }
+        BENCH_END;
+    }
+    arena_destroy(&arena);
+
+    // Fresh arena every iteration, so growing the chain is part of the cost
+    {
+        BENCH_BEGIN("arena_alloc_chained/24B", COUNT * ALLOC_SIZE);
+        BENCH_LOOP {
+            arena_init_chained(&arena, 0);
+            for(Size i = 0; i < COUNT; i += 1){
+                bench_sink += (Uintptr)arena_alloc(&arena, ALLOC_SIZE, 8);
+            }
+            arena_destroy(&arena);
+        }
+        BENCH_END;
+    }
+}
+
+// A request that uses 256 KiB of fresh memory
+static
+void bench_arena_pool(Arena* scratch){
+    enum { REQUEST_SIZE = 256 * KiB };
+    {
+        BENCH_BEGIN("arena_request/fresh", REQUEST_SIZE);
+        BENCH_LOOP {
+            Arena arena = {0};
+            arena_init_virtual(&arena, 64 * MiB);
+            U8* p = arena_alloc(&arena, REQUEST_SIZE, 8);
+            mem_set(p, 1, REQUEST_SIZE);
+            bench_sink += p[REQUEST_SIZE - 1];
+            arena_destroy(&arena);
+        }
+        BENCH_END;
+    }
+    {
+        ArenaPool pool = {0};
+        if(!arena_pool_init(&pool, scratch, 4, 64 * MiB, 1 * MiB)){ panic("Failed to init arena pool"); }
+        BENCH_BEGIN("arena_request/pooled", REQUEST_SIZE);
+        BENCH_LOOP {
+            Arena* arena = arena_pool_acquire(&pool);
+            U8* p = arena_alloc(arena, REQUEST_SIZE, 8);
+            mem_set(p, 1, REQUEST_SIZE);
+            bench_sink += p[REQUEST_SIZE - 1];
+            arena_pool_release(&pool, arena);
+        }
+        BENCH_END;
+        arena_pool_destroy(&pool);
+    }
+}
+
+static
+void bench_dyn_array_push(Arena* scratch){
+    (void)scratch;
+    enum { COUNT = 1000000 };
+    Arena arena = {0};
+    arena_init_virtual(&arena, 256 * MiB);
+
+    BENCH_BEGIN("dyn_array_push/I32", COUNT * sizeof(I32));
+    BENCH_LOOP {
+        arena_free_all(&arena);
+        struct { I32* v; Size len; Size cap; Allocator allocator; } arr = {
+            .allocator = arena_allocator(&arena),
+        };
+        for(I32 i = 0; i < COUNT; i += 1){
+            dyn_array_push(&arr, i);
+        }
+        bench_sink += arr.len;
+    }
+    BENCH_END;
+
+    arena_destroy(&arena);
+}
+
+static
+void bench_utf8_decode(Arena* scratch){
+    char name[64];
+    for(Size i = 0; i < CORPUS_SIZE_COUNT; i += 1){
+        String corpus = make_utf8_corpus(scratch, CORPUS_SIZES[i]);
+        snprintf(name, sizeof(name), "utf8_decode/%tdKiB", (Size)(CORPUS_SIZES[i] / KiB));
+
+        BENCH_BEGIN(name, corpus.len);
+        BENCH_LOOP {
+            UTF8Iterator it = str_iterator(corpus);
+            UTF8Decode dec = {0};
+            U64 acc = 0;
+            while(utf8_iter_next(&it, &dec)){
+                acc += dec.codepoint;
+            }
+            bench_sink += acc;
+        }
+        BENCH_END;
+    }
+}
+
+static
+void bench_str_trim(Arena* scratch){
+    static const Size PADDING[] = { 16, 1 * KiB, 64 * KiB };
+    char name[64];
+    for(Size i = 0; i < 3; i += 1){
+        Size pad = PADDING[i];
+        U8* buf = arena_push(scratch, U8, pad * 2 + 5);
+        mem_set(buf, ' ', pad);
+        mem_copy_no_overlap(&buf[pad], "hello", 5);
+        for(Size j = 0; j < pad; j += 1){
+            buf[pad + 5 + j] = (j & 1) ? '\t' : '\n';
+        }
+        String s = str_from_bytes(buf, pad * 2 + 5);
+        snprintf(name, sizeof(name), "str_trim/%tdB-padding", pad);
+
+        BENCH_BEGIN(name, s.len);
+        BENCH_LOOP {
+            bench_sink += str_trim(s, str_literal(" \t\n")).len;
+        }
+        BENCH_END;
+    }
+}
+
+typedef enum {
+    MemOp_Copy,
+    MemOp_Set,
+    MemOp_Compare,
+} MemOp;
+
+// Compare memory.h against libc for each size class, memcpy/memset/memcmp
+// are called through volatile pointers so the compiler can't inline them
+static
+void bench_mem_ops(Arena* scratch){
+    static const Size SIZES[] = { 8, 16, 32, 64, 256, 4 * KiB, 1 * MiB, 16 * MiB };
+    static char const* const OP_NAMES[] = { "mem_copy", "mem_set", "mem_compare" };
+    static char const* const LIBC_NAMES[] = { "memcpy", "memset", "memcmp" };
+    static void* (* volatile libc_memcpy)(void*, void const*, size_t) = memcpy;
+    static void* (* volatile libc_memset)(void*, int, size_t) = memset;
+    static int (* volatile libc_memcmp)(void const*, void const*, size_t) = memcmp;
+    char name[64];
+
+    U8* src = arena_push(scratch, U8, 16 * MiB + 64);
+    U8* dst = arena_push(scratch, U8, 16 * MiB + 64);
+    mem_set(src, 0x5a, 16 * MiB + 64);
+    mem_set(dst, 0x5a, 16 * MiB + 64);
+
+    for(I32 op = MemOp_Copy; op <= MemOp_Compare; op += 1){
+        for(Size i = 0; i < (Size)(sizeof(SIZES) / sizeof(SIZES[0])); i += 1){
+            Size size = SIZES[i];
+            // Repeat small operations so each run is long enough to be measured
+            Size reps = max((Size)1, (1 * MiB) / size);
+
+            for(I32 libc = 0; libc <= 1; libc += 1){
+                snprintf(name, sizeof(name), "%s/%tdB", libc ? LIBC_NAMES[op] : OP_NAMES[op], size);
+                BENCH_BEGIN(name, size * reps);
+                BENCH_LOOP {
+                    for(Size r = 0; r < reps; r += 1){
+                        U8 const* from = src + (r & 7);
+                        switch(op){
+                            case MemOp_Copy:
+                                if(libc){ libc_memcpy(dst, from, size); }
+                                else    { mem_copy(dst, from, size); }
+                            break;
+                            case MemOp_Set:
+                                if(libc){ libc_memset(dst, (U8)r, size); }
+                                else    { mem_set(dst, (U8)r, size); }
+                            break;
+                            case MemOp_Compare:
+                                if(libc){ bench_sink += libc_memcmp(dst, from, size); }
+                                else    { bench_sink += mem_compare(dst, from, size); }
+                            break;
+                        }
+                    }
+                    bench_sink += dst[size - 1];
+                }
+                BENCH_END;
+            }
+        }
+        // Compare needs equal buffers to scan the whole size
+        mem_set(dst, 0x5a, 16 * MiB + 64);
+    }
+}
+
+static
+void bench_lexer_next(Arena* scratch){
+    char name[64];
+
+    for(Size i = 0; i < CORPUS_SIZE_COUNT; i += 1){
+        String corpus = make_json_corpus(scratch, CORPUS_SIZES[i]);
+        snprintf(name, sizeof(name), "lexer_next/%tdKiB", (Size)(CORPUS_SIZES[i] / KiB));
+
+        BENCH_BEGIN(name, corpus.len);
+        BENCH_LOOP {
+            Lexer lex = lexer_create(corpus, NULL);
+            Size count = 0;
+            for(Token tk = lexer_next(&lex); tk.kind != TK_EndOfFile; tk = lexer_next(&lex)){
+                count += 1;
+            }
+            bench_sink += count;
+        }
+        BENCH_END;
+    }
+}
+
+static
+void bench_lexer_tokenize(Arena* scratch){
+    char name[64];
+    Arena token_arena = {0};
+    arena_init_virtual(&token_arena, 256 * MiB);
+
+    for(Size i = 0; i < CORPUS_SIZE_COUNT; i += 1){
+        String corpus = make_json_corpus(scratch, CORPUS_SIZES[i]);
+        snprintf(name, sizeof(name), "lexer_tokenize/%tdKiB", (Size)(CORPUS_SIZES[i] / KiB));
+
+        BENCH_BEGIN(name, corpus.len);
+        BENCH_LOOP {
+            arena_free_all(&token_arena);
+            TokenArray tokens = { .allocator = arena_allocator(&token_arena) };
+            Lexer lex = lexer_create(corpus, NULL);
+            lexer_tokenize(&lex, &tokens);
+            bench_sink += token_array_count_kind(&tokens, TK_String);
+        }
+        BENCH_END;
+    }
+
+    arena_destroy(&token_arena);
+}
+
+// One keystroke in the middle of a big source, typed then deleted, each
+// iteration re-lexes twice
+static
+void bench_lexer_relex(Arena* scratch){
+    Size size = 4 * MiB;
+    String insert = str_literal(" 1,");
+    String corpus = make_json_corpus(scratch, size);
+    Size at = corpus.len / 2;
+    U8* edited = arena_push(scratch, U8, corpus.len + insert.len);
+    mem_copy_no_overlap(edited, corpus.v, at);
+    mem_copy_no_overlap(&edited[at], insert.v, insert.len);
+    mem_copy_no_overlap(&edited[at + insert.len], &corpus.v[at], corpus.len - at);
+    String typed = str_from_bytes(edited, corpus.len + insert.len);
+
+    Arena token_arena = {0};
+    Arena window_arena = {0};
+    arena_init_virtual(&token_arena, 256 * MiB);
+    arena_init_virtual(&window_arena, 16 * MiB);
+    TokenArray tokens = { .allocator = arena_allocator(&token_arena) };
+    Lexer lex = lexer_create(corpus, NULL);
+    lexer_tokenize(&lex, &tokens);
+
+    BENCH_BEGIN("lexer_relex/4096KiB", corpus.len);
+    BENCH_LOOP {
+        if(!lexer_relex(&tokens, typed, (TextEdit){ .offset = at, .inserted = insert.len }, &window_arena, NULL)){ panic("Relex failed"); }
+        if(!lexer_relex(&tokens, corpus, (TextEdit){ .offset = at, .removed = insert.len }, &window_arena, NULL)){ panic("Relex failed"); }
+        bench_sink += tokens.len;
+    }
+    BENCH_END;
+
+    arena_destroy(&window_arena);
+    arena_destroy(&token_arena);
+}
+
+// Read a few fields out of a big object, which is mostly nested subtrees
+static
+void bench_ondemand_find_field(Arena* scratch){
+    static const Size OBJECT_SIZES[] = { 4 * KiB, 100 * KiB, 4 * MiB };
+    char name[64];
+
+    for(Size i = 0; i < 3; i += 1){
+        Size size = OBJECT_SIZES[i];
+        // Filler has to be balanced, unlike the lexer corpus
+        String record = str_literal("{ \"id\": 1234, \"name\": \"some \\\"name\\\"\", \"tags\": [\"a\", \"b\"], \"nested\": { \"x\": [1, 2] } }, ");
+        U8* fill = arena_push(scratch, U8, size);
+        Size fill_len = 0;
+        while(fill_len + record.len <= size){
+            mem_copy_no_overlap(&fill[fill_len], record.v, record.len);
+            fill_len += record.len;
+        }
+        String filler = str_from_bytes(fill, fill_len);
+        U8* buf = arena_push(scratch, U8, filler.len + 128);
+        Size len = 0;
+        String parts[] = {
+            str_literal("{ \"filler\": ["), filler,
+            str_literal("{}], \"id\": 7, \"name\": \"n\", \"score\": 1.5 }"),
+        };
+        for(Size p = 0; p < 3; p += 1){
+            mem_copy_no_overlap(&buf[len], parts[p].v, parts[p].len);
+            len += parts[p].len;
+        }
+        String doc = str_from_bytes(buf, len);
+
+        snprintf(name, sizeof(name), "ondemand_find_field/%tdKiB", (Size)(size / KiB));
+        BENCH_BEGIN(name, doc.len);
+        BENCH_LOOP {
+            JsonValue root = json_root(doc), v;
+            I64 id = 0;
+            if(json_find_field(root, str_literal("id"), &v)){ json_get_i64(v, &id); }
+            if(json_find_field(root, str_literal("score"), &v)){ bench_sink += v.offset; }
+            else { panic("Field not found"); }
+            bench_sink += id;
+        }
+        BENCH_END;
+    }
+}
+
+static
+bool bench_query_func(void* data, JsonValue value){
+    I64 n = 0;
+    json_get_i64(value, &n);
+    *(I64*)data += n;
+    return true;
+}
+
+// Same compiled query over many small documents, compile cost is paid once
+static
+void bench_query_run(Arena* scratch){
+    enum { DOC_COUNT = 1000 };
+    String record = str_literal("{ \"id\": 1234, \"name\": \"some name\", \"tags\": [\"a\", \"b\"], \"items\": [{ \"price\": 3 }, { \"price\": 4 }] }");
+
+    JsonQuery query = {0};
+    if(!json_query_compile(&query, scratch, str_literal("$.items[*].price"))){
+        panic("Failed to compile query");
+    }
+
+    BENCH_BEGIN("query_run/$.items[*].price", record.len * DOC_COUNT);
+    BENCH_LOOP {
+        I64 total = 0;
+        for(Size i = 0; i < DOC_COUNT; i += 1){
+            json_query_run(&query, json_root(record), bench_query_func, &total);
+        }
+        if(total != 7 * DOC_COUNT){ panic("Bad query result"); }
+        bench_sink += total;
+    }
+    BENCH_END;
+}
+
+// Build once, then compare reopening the image against finding the same field on the source
+// Well formed document of at most `size` bytes, an array of records followed by "id" and "score"
+static
+String make_json_document(Arena* arena, Size size){
+    String record = str_literal("{ \"id\": 1234, \"name\": \"some name\", \"tags\": [\"a\", \"b\"], \"nested\": { \"x\": [1, 2] } }, ");
+    U8* buf = arena_push(arena, U8, size + 128);
+    Size len = 0;
+    String head = str_literal("{ \"filler\": [");
+    String tail = str_literal("{}], \"id\": 7, \"score\": 1.5 }");
+    mem_copy_no_overlap(buf, head.v, head.len);
+    len += head.len;
+    while(len + record.len + tail.len <= size){
+        mem_copy_no_overlap(&buf[len], record.v, record.len);
+        len += record.len;
+    }
+    mem_copy_no_overlap(&buf[len], tail.v, tail.len);
+    len += tail.len;
+    return str_from_bytes(buf, len);
+}
+
+static
+void bench_tape(Arena* scratch){
+    String doc = make_json_document(scratch, 4 * MiB);
+
+    TapeBuilder builder = {0};
+    tape_builder_init(&builder, arena_allocator(scratch));
+
+    {
+        BENCH_BEGIN("tape_build/4096KiB", doc.len);
+        BENCH_LOOP {
+            if(!tape_build(&builder, doc)){ panic("Failed to build tape"); }
+        }
+        BENCH_END;
+    }
+
+    U8* image = arena_push(scratch, U8, tape_image_size(&builder));
+    tape_image(&builder, image);
+
+    {
+        BENCH_BEGIN("tape_open_find/4096KiB", doc.len);
+        BENCH_LOOP {
+            Tape t = {0};
+            Size node = 0;
+            F64 score = 0;
+            if(!tape_open(&t, image, tape_image_size(&builder))){ panic("Failed to open tape"); }
+            if(!tape_find_field(&t, tape_root(&t), str_literal("score"), &node)){ panic("Field not found"); }
+            tape_get_f64(&t, node, &score);
+            bench_sink += (U64)score;
+        }
+        BENCH_END;
+    }
+}
+
+#define BENCH_ITEM_FIELDS(X) X(I64, id) X(String, name) X(F64, price) X(I32, qty) X(bool, active)
+SCHEMA_DECLARE(BenchItem, BENCH_ITEM_FIELDS)
+SCHEMA_DEFINE(BenchItem, BENCH_ITEM_FIELDS)
+
+// Fixed schema decode against one json_find_field per field
+static
+void bench_schema_decode(Arena* scratch){
+    (void)scratch;
+    enum { DOC_COUNT = 1000 };
+    String record = str_literal("{ \"id\": 1234, \"name\": \"some name\", \"tags\": [\"a\", \"b\"], \"price\": 9.5, \"qty\": 3, \"active\": true }");
+
+    {
+        BENCH_BEGIN("schema_decode/BenchItem", record.len * DOC_COUNT);
+        BENCH_LOOP {
+            for(Size i = 0; i < DOC_COUNT; i += 1){
+                BenchItem item = {0};
+                if(!BenchItem_decode(json_root(record), &item)){ panic("Failed to decode"); }
+                bench_sink += item.id + item.qty;
+            }
+        }
+        BENCH_END;
+    }
+    {
+        BENCH_BEGIN("find_field_decode/BenchItem", record.len * DOC_COUNT);
+        BENCH_LOOP {
+            for(Size i = 0; i < DOC_COUNT; i += 1){
+                BenchItem item = {0};
+                JsonValue root = json_root(record), v;
+                I64 qty = 0;
+                if(json_find_field(root, str_literal("id"), &v)){ json_get_i64(v, &item.id); }
+                if(json_find_field(root, str_literal("name"), &v)){ json_get_string(v, &item.name); }
+                if(json_find_field(root, str_literal("price"), &v)){ json_get_f64(v, &item.price); }
+                if(json_find_field(root, str_literal("qty"), &v)){ json_get_i64(v, &qty); }
+                if(json_find_field(root, str_literal("active"), &v)){ json_get_bool(v, &item.active); }
+                bench_sink += item.id + qty;
+            }
+        }
+        BENCH_END;
+    }
+}
+
+// Building a document from many small pieces: clone-and-concat against both builder modes
+static
+void bench_string_builder(Arena* scratch){
+    enum { PIECES = 2000 };
+    String piece = str_literal("{ \"key\": 12345 },\n");
+    Arena arena = {0};
+    if(!arena_init_virtual(&arena, 1 * GiB)){ panic("Failed to reserve virtual memory"); }
+    (void)scratch;
+
+    {
+        BENCH_BEGIN("str_concat/2000", piece.len * PIECES);
+        BENCH_LOOP {
+            String out = {0};
+            for(Size i = 0; i < PIECES; i += 1){
+                out = str_concat(out, piece, arena_allocator(&arena));
+            }
+            bench_sink += out.len;
+            arena_free_all(&arena);
+        }
+        BENCH_END;
+    }
+    {
+        BENCH_BEGIN("string_builder_buffer/2000", piece.len * PIECES);
+        BENCH_LOOP {
+            StringBuilder sb = {0};
+            string_builder_init_buffer(&sb, &arena, 0);
+            for(Size i = 0; i < PIECES; i += 1){
+                string_builder_append(&sb, piece);
+            }
+            bench_sink += string_builder_build(&sb).len;
+            arena_free_all(&arena);
+        }
+        BENCH_END;
+    }
+    {
+        BENCH_BEGIN("string_builder_rope/2000", piece.len * PIECES);
+        BENCH_LOOP {
+            StringBuilder sb = {0};
+            string_builder_init_rope(&sb, &arena);
+            for(Size i = 0; i < PIECES; i += 1){
+                string_builder_append(&sb, piece);
+            }
+            bench_sink += string_builder_build(&sb).len;
+            arena_free_all(&arena);
+        }
+        BENCH_END;
+    }
+    arena_destroy(&arena);
+}
+
+static
+void bench_hash(Arena* scratch){
+    static const Size SIZES[] = { 8, 32, 256, 4 * KiB, 1 * MiB };
+    char name[64];
+    U8* data = arena_push(scratch, U8, 1 * MiB);
+    for(Size i = 0; i < 1 * MiB; i += 1){ data[i] = (U8)bench_rand(); }
+
+    for(Size i = 0; i < (Size)(sizeof(SIZES) / sizeof(SIZES[0])); i += 1){
+        Size size = SIZES[i];
+        Size reps = max((Size)1, (1 * MiB) / size);
+        for(I32 local = 0; local <= 1; local += 1){
+            snprintf(name, sizeof(name), "%s/%tdB", local ? "hash_bytes_local" : "hash_bytes", size);
+            BENCH_BEGIN(name, size * reps);
+            BENCH_LOOP {
+                U64 h = 0;
+                for(Size r = 0; r < reps; r += 1){
+                    h ^= local ? hash_bytes_local(data + (r & 7), size, h) : hash_bytes(data + (r & 7), size, h);
+                }
+                bench_sink += h;
+            }
+            BENCH_END;
+        }
+    }
+}
+
+static
+void bench_doc_cache(Arena* scratch){
+    String doc = make_json_document(scratch, 64 * KiB);
+    DocCache cache = {0};
+    if(!doc_cache_init(&cache, arena_allocator(scratch), 16, 64 * MiB)){ panic("Failed to init cache"); }
+
+    {
+        BENCH_BEGIN("doc_cache_miss/64KiB", doc.len);
+        BENCH_LOOP {
+            doc_cache_clear(&cache);
+            DocCacheEntry const* e = doc_cache_get(&cache, doc);
+            if(e == NULL){ panic("Failed to parse document"); }
+            bench_sink += e->tokens.len;
+        }
+        BENCH_END;
+    }
+    {
+        BENCH_BEGIN("doc_cache_hit/64KiB", doc.len);
+        BENCH_LOOP {
+            DocCacheEntry const* e = doc_cache_get(&cache, doc);
+            if(e == NULL){ panic("Failed to parse document"); }
+            bench_sink += e->tokens.len;
+        }
+        BENCH_END;
+    }
+    doc_cache_destroy(&cache);
+}
+
+int main(int argc, char** argv){
+    virtual_init();
+    for(int i = 1; i < argc; i += 1){
+        if(str_eq(str_from(argv[i]), str_literal("--csv"))){
+            bench_csv = true;
+        }
+    }
+
+    Arena scratch = {0};
+    if(!arena_init_virtual(&scratch, 1 * GiB)){
+        panic("Failed to reserve virtual memory");
+    }
+
+    if(bench_csv){
+        printf("name,bytes_per_run,runs,median_ns,p99_ns,bytes_per_sec\n");
+    }
+
+    bench_arena_alloc(&scratch);
+    bench_arena_pool(&scratch);
+    bench_dyn_array_push(&scratch);
+    bench_utf8_decode(&scratch);
+    bench_str_trim(&scratch);
+    bench_mem_ops(&scratch);
+    bench_string_builder(&scratch);
+    bench_hash(&scratch);
+    bench_lexer_next(&scratch);
+    bench_lexer_tokenize(&scratch);
+    bench_lexer_relex(&scratch);
+    bench_ondemand_find_field(&scratch);
+    bench_query_run(&scratch);
+    bench_tape(&scratch);
+    bench_schema_decode(&scratch);
+    bench_doc_cache(&scratch);
+
+    arena_destroy(&scratch);
+}
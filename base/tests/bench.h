@@ -0,0 +1,74 @@
+#pragma once
+
+#define BENCH_MAX_RUNS 1000
+#define BENCH_WARMUP 3
+#define BENCH_RUNS 31
+
+typedef struct {
+    char const* title;
+    Size bytes;  // Bytes processed per run, used for throughput
+    I32 run;     // Negative while warming up
+    I32 runs;
+    U64 start;
+    U64 samples[BENCH_MAX_RUNS];
+} Benchmark;
+
+// Print one comma separated line per benchmark instead of a table
+static bool bench_csv = false;
+
+// Write results here so the compiler can't drop the benchmarked work
+static volatile U64 bench_sink = 0;
+
+static inline
+Benchmark bench_begin(char const* title, Size bytes, I32 runs){
+    Benchmark b = {0};
+    b.title = title;
+    b.bytes = bytes;
+    b.runs = min(runs, BENCH_MAX_RUNS);
+    b.run = -BENCH_WARMUP - 1;
+    return b;
+}
+
+static inline
+bool bench_next(Benchmark* b){
+    U64 now = time_now_ns();
+    if(b->run >= 0){
+        b->samples[b->run] = now - b->start;
+    }
+    b->run += 1;
+    if(b->run >= b->runs){
+        return false;
+    }
+    b->start = time_now_ns();
+    return true;
+}
+
+static inline
+void bench_end(Benchmark* b){
+    // Insertion sort, sample counts are small
+    for(I32 i = 1; i < b->runs; i += 1){
+        U64 v = b->samples[i];
+        I32 j = i - 1;
+        for(; j >= 0 && b->samples[j] > v; j -= 1){
+            b->samples[j + 1] = b->samples[j];
+        }
+        b->samples[j + 1] = v;
+    }
+
+    U64 median = b->samples[b->runs / 2];
+    U64 p99 = b->samples[min(b->runs - 1, (b->runs * 99) / 100)];
+    F64 bytes_per_sec = median > 0 ? ((F64)b->bytes * 1e9) / (F64)median : 0.0;
+
+    if(bench_csv){
+        printf("%s,%td,%d,%llu,%llu,%.0f\n", b->title, b->bytes, b->runs,
+            (unsigned long long)median, (unsigned long long)p99, bytes_per_sec);
+    }
+    else {
+        printf("  %-36s median %12.3f us  p99 %12.3f us  %10.1f MiB/s\n", b->title,
+            (F64)median / 1e3, (F64)p99 / 1e3, bytes_per_sec / (F64)MiB);
+    }
+}
+
+#define BENCH_BEGIN(Title, Bytes) Benchmark _bench = bench_begin((Title), (Bytes), BENCH_RUNS);
+#define BENCH_LOOP while(bench_next(&_bench))
+#define BENCH_END bench_end(&_bench)
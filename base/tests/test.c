@@ -1,8 +1,152 @@
+// Build with, e.g.:
+//   cc -std=c17 -DTARGET_OS_LINUX base/tests/test.c base/base.c lexer.c ondemand.c query.c tape.c schema.c doc_cache.c -o test -lpthread
 #include "../base.h"
 #include "test.h"
 #include "../memory.h"
 #include "../virtual_memory.h"
 #include "../arena.h"
+#include "../strings.h"
+#include "../filesystem.h"
+#include "../pool.h"
+#include "../heap.h"
+#include "../allocator.h"
+#include "../dynamic_array.h"
+#include "../jobs.h"
+#include "../queue.h"
+#include "../arena_pool.h"
+#include "../string_builder.h"
+#include "../hash.h"
+#include "../trace.h"
+#include "../../lexer.h"
+#include "../../ondemand.h"
+#include "../../query.h"
+#include "../../tape.h"
+#include "../../schema.h"
+#include "../../doc_cache.h"
+#include <stdio.h>
+
+static inline
+void memory_test(){
+    TEST_BEGIN("Memory");
+    static U8 a[4096 + 64], b[4096 + 64];
+    static const Size SIZES[] = { 0, 1, 3, 7, 8, 15, 16, 17, 33, 63, 64, 65, 200, 4096 };
+
+    bool copy_ok = true, set_ok = true, compare_ok = true;
+    for(Size i = 0; i < (Size)(sizeof(SIZES) / sizeof(SIZES[0])); i += 1){
+        Size n = SIZES[i];
+        for(Size k = 0; k < n + 8; k += 1){ a[k] = (U8)(k * 7 + 1); }
+
+        mem_set(b, 0, sizeof(b));
+        mem_copy_no_overlap(b + 3, a + 5, n);
+        for(Size k = 0; k < n; k += 1){ copy_ok = copy_ok && b[k + 3] == a[k + 5]; }
+        copy_ok = copy_ok && b[n + 3] == 0 && b[2] == 0;
+
+        mem_set(b + 1, 0xab, n);
+        for(Size k = 0; k < n; k += 1){ set_ok = set_ok && b[k + 1] == 0xab; }
+        set_ok = set_ok && b[0] == 0 && b[n + 1] != 0xab;
+
+        mem_copy_no_overlap(b, a, n);
+        compare_ok = compare_ok && mem_compare(a, b, n) == 0;
+        if(n > 0){
+            b[n - 1] += 1;
+            compare_ok = compare_ok && mem_compare(a, b, n) == -1 && mem_compare(b, a, n) == 1;
+        }
+    }
+    Test(copy_ok);
+    Test(set_ok);
+    Test(compare_ok);
+
+    // Overlapping copies in both directions
+    for(Size k = 0; k < 300; k += 1){ a[k] = (U8)k; }
+    mem_copy(a + 10, a, 200);
+    Test(a[10] == 0 && a[209] == 199);
+    mem_copy(a, a + 10, 200);
+    Test(a[0] == 0 && a[199] == 199);
+    TEST_END;
+}
+
+static inline
+void string_builder_test(){
+    TEST_BEGIN("String Builder");
+    static U8 memory[64 * KiB];
+    Arena arena = {0};
+    arena_init_buffer(&arena, memory, sizeof(memory));
+
+    StringBuilder sb = {0};
+    Test(string_builder_init_buffer(&sb, &arena, 4));
+    U8* first = sb.data;
+    bool in_place = true;
+    for(I32 i = 0; i < 100; i += 1){
+        string_builder_append(&sb, str_literal("abc"));
+        in_place = in_place && sb.data == first;
+    }
+    Test(in_place);
+    Test(string_builder_append_rune(&sb, 0x00e9));
+    String built = string_builder_build(&sb);
+    Test(built.len == 302 && built.v[300] == 0xc3);
+
+    // Something else was allocated, growing has to move the buffer
+    arena_alloc(&arena, 1, 1);
+    while(sb.len + 3 <= sb.cap){ string_builder_append(&sb, str_literal("-")); }
+    Test(string_builder_append(&sb, str_literal("xyz")));
+    Test(sb.data != first && str_ends_with(string_builder_build(&sb), str_literal("-xyz")));
+
+    String src = str_literal("hello, world");
+    Test(string_builder_init_rope(&sb, &arena));
+    string_builder_append(&sb, str_sub(src, 0, 5));
+    string_builder_append(&sb, str_sub(src, 5, 2)); /* Adjacent, merged */
+    string_builder_append(&sb, str_literal("rope"));
+    Test(sb.len == 2 && sb.byte_len == 11);
+    Test(str_eq(string_builder_build(&sb), str_literal("hello, rope")));
+    Test(sb.kind == StringBuilderKind_Buffer);
+    TEST_END;
+}
+
+static inline
+void hash_test(){
+    TEST_BEGIN("Hash");
+    static U8 data[1000];
+    for(Size i = 0; i < (Size)sizeof(data); i += 1){ data[i] = (U8)(i * 31 + 7); }
+
+    // Streaming matches one-shot for any split
+    bool stream_ok = true;
+    static const Size CHUNKS[] = { 1, 5, 16, 47, 48, 49, 100 };
+    for(Size n = 0; n < (Size)sizeof(data); n += 37){
+        U64 h = hash_bytes(data, n, 7);
+        for(Size c = 0; c < (Size)(sizeof(CHUNKS) / sizeof(CHUNKS[0])); c += 1){
+            HashState st = hash_begin(7);
+            for(Size off = 0; off < n; off += CHUNKS[c]){
+                hash_update(&st, data + off, min(CHUNKS[c], n - off));
+            }
+            stream_ok = stream_ok && hash_end(&st) == h;
+        }
+    }
+    Test(stream_ok);
+
+    // hash_bytes is stable, these must never change. The lengths hit every
+    // path: empty, under 4, up to 16, 16 byte rounds up to 48, 48 byte blocks
+    static const struct { Size len; U64 hash; } KNOWN[] = {
+        {   0, 0x9411771484003547ull },
+        {   3, 0x256359facf049745ull },
+        {  16, 0x850787cef0b04465ull },
+        {  17, 0x6501aa43f9d9e05eull },
+        {  48, 0xf2d0469875a67df6ull },
+        {  49, 0xb9fbfecc5c289fdbull },
+        { 100, 0x91e6ce9b73c587b7ull },
+    };
+    bool known_ok = true;
+    for(Size i = 0; i < (Size)(sizeof(KNOWN) / sizeof(KNOWN[0])); i += 1){
+        known_ok = known_ok && hash_bytes(data, KNOWN[i].len, 7) == KNOWN[i].hash;
+    }
+    Test(known_ok);
+
+    Test(hash_bytes(data, 100, 1) != hash_bytes(data, 100, 2));
+    Test(hash_bytes(data, 100, 1) != hash_bytes(data, 99, 1));
+    Test(hash_str(str_literal("key"), 0) == hash_bytes("key", 3, 0));
+    Test(hash_bytes_local(data, 500, 3) == hash_bytes_local(data, 500, 3));
+    Test(hash_bytes_local(data, 500, 3) != hash_bytes_local(data + 1, 500, 3));
+    TEST_END;
+}
 
 static inline
 void arena_buf_test(){
@@ -50,9 +194,1194 @@ void arena_virt_test(){
     TEST_END;
 }
 
+static inline
+void arena_chained_test(){
+    TEST_BEGIN("Arena (Chained)");
+    Arena arena = {0};
+    Test(arena_init_chained(&arena, 0));
+    Test(arena.data.reserved == ARENA_VIRTUAL_BLOCK_SIZE);
+
+    U8* first = arena_alloc(&arena, 16, 8);
+    Test(first != NULL);
+    void* first_block = arena.data.ptr;
+    bool ok = true;
+    for(int i = 0; i < 1024; i += 1){
+        U8* p = arena_alloc(&arena, 1000, 8);
+        ok = ok && p != NULL;
+        if(p){ mem_set(p, (U8)i, 1000); }
+    }
+    Test(ok);
+    Test(arena.data.ptr != first_block);
+    Test(arena.data.reserved > 2 * ARENA_VIRTUAL_BLOCK_SIZE); /* Grows geometrically */
+
+    Size block_size = arena.data.reserved;
+    ArenaTemp tmp = arena_temp_begin(&arena);
+    U8* big = arena_alloc(&arena, ARENA_CHAINED_MAX_BLOCK + 1, 64);
+    Test(big != NULL && ((Uintptr)big & 63) == 0);
+    big[ARENA_CHAINED_MAX_BLOCK] = 1;
+    arena_temp_end(tmp);
+    Test(arena.data.reserved == block_size);
+
+    U8* r = arena_alloc(&arena, 10, 1);
+    Test(arena_resize(&arena, r, 20) == r);
+    Test(arena_resize(&arena, r, arena.data.reserved) == NULL);
+
+    arena_free_all(&arena);
+    Test(arena.data.reserved == block_size);
+    Test(((ArenaBlock*)arena.data.ptr)->prev == NULL);
+    Test(arena_alloc(&arena, 8, 8) != NULL);
+    arena_destroy(&arena);
+    Test(arena.data.ptr == NULL);
+    TEST_END;
+}
+
+static inline
+void arena_retention_test(){
+    TEST_BEGIN("Arena (Retention)");
+    Arena arena = {0};
+    Test(arena_init_virtual(&arena, 1 * GiB));
+
+    arena_set_retention(&arena, ArenaRetention_Fixed, 1 * MiB, true);
+    U8* p = arena_alloc(&arena, 8 * MiB, 8);
+    Test(p != NULL);
+    mem_set(p, 1, 8 * MiB);
+    Test(arena.data.commited >= 8 * MiB);
+    arena_free_all(&arena);
+    Test(arena.data.commited == 1 * MiB);
+    p = arena_alloc(&arena, 2 * MiB, 8);
+    Test(p != NULL && p[2 * MiB - 1] == 0); /* Past the retained part, dropped eagerly */
+
+    arena_set_retention(&arena, ArenaRetention_Decay, 256 * KiB, false);
+    arena_alloc(&arena, 14 * MiB, 8);
+    arena_free_all(&arena);
+    Size after_spike = arena.data.commited;
+    Test(after_spike >= 16 * MiB);
+    for(int i = 0; i < 32; i += 1){
+        arena_alloc(&arena, 1024, 8);
+        arena_free_all(&arena);
+    }
+    Test(arena.data.commited < after_spike && arena.data.commited <= 512 * KiB);
+    Test(arena.data.commited >= 256 * KiB);
+
+    Test(arena_trim(&arena, 0) > 0);
+    Test(arena.data.commited == 0);
+    arena_destroy(&arena);
+    TEST_END;
+}
+
+
+#if defined(ARENA_STATS)
+#define ARENA_STATS_TEST_THREADS 8
+#define ARENA_STATS_TEST_ROUNDS 1000
+
+// Four call sites on consecutive lines, first touched by several threads at once
+enum { ARENA_STATS_TEST_LINE = __LINE__ + 6 };
+static
+void arena_stats_test_worker(void* arg){
+    Arena* arena = arg;
+    for(Size i = 0; i < ARENA_STATS_TEST_ROUNDS; i += 1){
+        arena_free_all(arena);
+        (void)arena_alloc(arena, 8, 8);
+        (void)arena_alloc(arena, 16, 8);
+        (void)arena_alloc(arena, 24, 8);
+        (void)arena_alloc(arena, 32, 8);
+    }
+}
+
+static inline
+void arena_stats_test(){
+    TEST_BEGIN("Arena (Stats)");
+    Arena arena = {0};
+    Test(arena_init_virtual(&arena, 64 * MiB));
+
+    U8* a = arena_alloc(&arena, 10, 1); I32 line_a = __LINE__;
+    U8* b = arena_alloc(&arena, 8, 8); I32 line_b = __LINE__;
+    U8* c = arena_realloc(&arena, a, 10, 20, 1); I32 line_c = __LINE__;
+    Test(a != NULL && b != NULL && c != NULL && c != a);
+
+    #if !defined(ARENA_DEBUG)
+    Test(arena_realloc(&arena, c, 20, 30, 1) == c); /* Last one grows in place */
+    // 10 + 6 padding + 8, then 20 moved past them leaving 10 behind, grown to 30
+    ArenaStats st = arena.stats;
+    Test(st.alloc_count == 3);
+    Test(st.bytes_requested == 38 && st.bytes_padding == 6);
+    Test(st.bytes_abandoned == 10);
+    Test(st.peak_offset == 54 && arena.offset == 54);
+    Test(st.commit_count == 1);
+    Test(arena_alloc(&arena, VIRTUAL_PAGE_SIZE, 8) != NULL);
+    Test(arena.stats.commit_count == 2);
+    arena_free_all(&arena);
+    Test(arena.stats.peak_offset >= VIRTUAL_PAGE_SIZE && arena.offset == 0);
+    #endif
+
+    ArenaCallSite const* site_a = arena_stats_site_find(__FILE__, line_a);
+    ArenaCallSite const* site_b = arena_stats_site_find(__FILE__, line_b);
+    ArenaCallSite const* site_c = arena_stats_site_find(__FILE__, line_c);
+    Test(site_a != NULL && site_b != NULL && site_c != NULL && site_a != site_b);
+    Test(atomic_load(&site_a->alloc_count) == 1 && atomic_load(&site_a->bytes_requested) == 10);
+    Test(atomic_load(&site_b->alloc_count) == 1 && atomic_load(&site_b->bytes_requested) == 8);
+    Test(atomic_load(&site_c->alloc_count) == 1 && atomic_load(&site_c->bytes_requested) == 20);
+    Test(arena_stats_site_find(__FILE__, -1) == NULL);
+    arena_destroy(&arena);
+
+    static Arena arenas[ARENA_STATS_TEST_THREADS];
+    Thread threads[ARENA_STATS_TEST_THREADS];
+    for(Size i = 0; i < ARENA_STATS_TEST_THREADS; i += 1){
+        Test(arena_init_virtual(&arenas[i], 16 * MiB));
+        Test(thread_create(&threads[i], arena_stats_test_worker, &arenas[i]));
+    }
+    for(Size i = 0; i < ARENA_STATS_TEST_THREADS; i += 1){
+        thread_join(&threads[i]);
+        arena_destroy(&arenas[i]);
+    }
+    bool sites_ok = true;
+    for(I32 i = 0; i < 4; i += 1){
+        ArenaCallSite const* site = arena_stats_site_find(__FILE__, ARENA_STATS_TEST_LINE + i);
+        Size expected = ARENA_STATS_TEST_THREADS * ARENA_STATS_TEST_ROUNDS;
+        sites_ok = sites_ok && site != NULL
+            && atomic_load(&site->alloc_count) == expected
+            && atomic_load(&site->bytes_requested) == expected * 8 * (i + 1);
+    }
+    Test(sites_ok);
+    TEST_END;
+}
+#endif
+
+#if defined(ARENA_DEBUG)
+static inline
+void arena_debug_test(){
+    TEST_BEGIN("Arena (Debug)");
+    Arena arena = {0};
+    Test(arena_init_virtual(&arena, 64 * MiB));
+
+    U8* a = arena_alloc(&arena, 100, 4);
+    U8* b = arena_alloc(&arena, 3 * VIRTUAL_PAGE_SIZE, 16);
+    Test(a != NULL && b != NULL);
+    Test(((Uintptr)(a + 100) & (VIRTUAL_PAGE_SIZE - 1)) == 0);
+    Test(((Uintptr)(b + 3 * VIRTUAL_PAGE_SIZE) & (VIRTUAL_PAGE_SIZE - 1)) == 0);
+    Test(b - a >= VIRTUAL_PAGE_SIZE + 100);
+    mem_set(a, 1, 100);
+    mem_set(b, 2, 3 * VIRTUAL_PAGE_SIZE);
+
+    Test(arena_resize(&arena, b, 10) == b);
+    Test(arena_resize(&arena, b, 3 * VIRTUAL_PAGE_SIZE + 1) == NULL);
+
+    ArenaTemp tmp = arena_temp_begin(&arena);
+    U8* c = arena_alloc(&arena, 8, 8);
+    c[0] = 3;
+    arena_temp_end(tmp);
+    Test(c[0] == ARENA_POISON_BYTE);
+
+    arena_free_all(&arena);
+    Test(a[0] == ARENA_POISON_BYTE && a[99] == ARENA_POISON_BYTE);
+    Test(b[0] == ARENA_POISON_BYTE);
+    a = arena_alloc(&arena, 2 * VIRTUAL_PAGE_SIZE, 8);
+    mem_set(a, 4, 2 * VIRTUAL_PAGE_SIZE); /* Old guard pages are writable again */
+    arena_destroy(&arena);
+
+    static U8 memory[64];
+    Test(arena_init_buffer(&arena, memory, sizeof(memory)));
+    mem_set(arena_alloc(&arena, 16, 1), 0, 16);
+    Test(arena_alloc(&arena, 1024, 1) == NULL);
+    arena_free_all(&arena);
+    Test(memory[0] == ARENA_POISON_BYTE && memory[15] == ARENA_POISON_BYTE);
+
+    /* Exact fit reservations have no room for guards */
+    Test(arena_init_virtual(&arena, 3 * VIRTUAL_PAGE_SIZE));
+    a = arena_alloc(&arena, VIRTUAL_PAGE_SIZE, 8);
+    b = arena_alloc(&arena, VIRTUAL_PAGE_SIZE / 2, 8);
+    c = arena_alloc(&arena, 100, 8);
+    Test(a != NULL && b != NULL && c != NULL);
+    Test(arena_resize(&arena, c, 200) == c);
+    mem_set(b, 5, VIRTUAL_PAGE_SIZE / 2);
+    mem_set(c, 6, 200);
+    Test(arena_alloc(&arena, 2 * VIRTUAL_PAGE_SIZE, 8) == NULL);
+    arena_destroy(&arena);
+
+    /* Filling a chained block up to its guard page */
+    Test(arena_init_chained(&arena, ARENA_VIRTUAL_BLOCK_SIZE));
+    Size room = ARENA_VIRTUAL_BLOCK_SIZE - arena.offset;
+    a = arena_alloc(&arena, room, 1);
+    Test(a != NULL);
+    mem_set(a, 7, room);
+    b = arena_alloc(&arena, 64, 8);
+    Test(b != NULL && (void*)b != (void*)a);
+    mem_set(b, 8, 64);
+    arena_free_all(&arena);
+    arena_destroy(&arena);
+    TEST_END;
+}
+#endif
+
+static inline
+void file_writer_test(){
+    TEST_BEGIN("File Writer");
+    static U8 memory[4096];
+    Arena arena = {0};
+    arena_init_buffer(&arena, memory, sizeof(memory));
+
+    String path = str_literal("/tmp/_base_file_writer_test.txt");
+    FileHandle f = {0};
+    Test(file_open(&f, path, Write | Create));
+
+    FileWriter w = {0};
+    Test(file_writer_init(&w, f, &arena, 64));
+
+    static U8 big[FILE_WRITER_COPY_THRESHOLD + 1];
+    mem_set(big, 'x', sizeof(big));
+
+    String parts[] = {
+        str_literal("hello"),
+        str_literal(", "),
+        str_from_bytes(big, sizeof(big)),
+        str_literal("world"),
+    };
+    Test(file_writer_write_many(&w, parts, 4));
+    Test(w.len == 0);
+    Test(file_writer_write(&w, str_literal("!")));
+    Test(file_writer_flush(&w));
+    file_close(f);
+
+    FILE* fp = fopen("/tmp/_base_file_writer_test.txt", "rb");
+    Test(fp != NULL);
+    static char readback[sizeof(big) + 64];
+    Size n = fread(readback, 1, sizeof(readback), fp);
+    fclose(fp);
+    Test(n == 5 + 2 + (Size)sizeof(big) + 5 + 1);
+    Test(mem_compare(readback, "hello, x", 8) == 0);
+    Test(mem_compare(&readback[n - 6], "world!", 6) == 0);
+
+    FileMapping m = {0};
+    Test(file_map(&m, path));
+    Test(m.len == n);
+    Test(mem_compare(m.data, readback, n) == 0);
+    file_unmap(&m);
+    Test(m.data == NULL);
+
+    TEST_END;
+}
+
+static inline
+void pool_test(){
+    TEST_BEGIN("Pool");
+    static U8 memory[64 * KiB];
+    Arena arena = {0};
+    arena_init_buffer(&arena, memory, sizeof(memory));
+
+    Pool pool = {0};
+    Test(pool_init(&pool, &arena, 24, 8));
+    Test(pool.slot_size == 24);
+
+    U64* a = pool_new(&pool, U64);
+    U64* b = pool_new(&pool, U64);
+    Test(a != NULL && b != NULL && a != b);
+    Test(((Uintptr)a & 7) == 0);
+    Test(pool.in_use == 2);
+
+    pool_free(&pool, a);
+    U64* c = pool_new(&pool, U64);
+    Test(c == a);
+
+    bool all_ok = true;
+    for(Size i = 0; i < pool.chunk_slots * 2; i += 1){
+        all_ok = all_ok && pool_alloc(&pool) != NULL;
+    }
+    Test(all_ok);
+    Size arena_used = arena.offset;
+
+    pool_free_all(&pool);
+    Test(pool.in_use == 0);
+    for(Size i = 0; i < pool.chunk_slots * 2; i += 1){
+        pool_alloc(&pool);
+    }
+    Test(arena.offset == arena_used);
+
+    TEST_END;
+}
+
+static inline
+void heap_test(){
+    TEST_BEGIN("Heap");
+    Heap heap = {0};
+    Test(heap_init(&heap, 64 * MiB));
+
+    U8* small[512];
+    bool all_ok = true;
+    for(Size i = 0; i < 512; i += 1){
+        small[i] = heap_alloc(&heap, 1 + i * 7, 8);
+        all_ok = all_ok && small[i] != NULL;
+        if(small[i]){ mem_set(small[i], (U8)i, 1 + i * 7); }
+    }
+    Test(all_ok);
+    for(Size i = 0; i < 512; i += 2){
+        heap_free(&heap, small[i]);
+    }
+    for(Size i = 1; i < 512; i += 2){
+        all_ok = all_ok && small[i][i * 7] == (U8)i;
+    }
+    Test(all_ok);
+
+    void* aligned = heap_alloc(&heap, 100, 64);
+    Test(((Uintptr)aligned & 63) == 0);
+    Test(heap_resize(&heap, aligned, heap_usable_size(&heap, aligned)) == aligned);
+
+    U8* big = heap_alloc(&heap, 100 * KiB, 16);
+    Test(big != NULL);
+    mem_set(big, 0xab, 100 * KiB);
+    Test(heap_resize(&heap, big, 200 * KiB) == big);
+    big = heap_realloc(&heap, big, 1 * MiB, 16);
+    Test(big != NULL && big[100 * KiB - 1] == 0xab);
+    Test(heap_resize(&heap, big, 64 * KiB) == big);
+
+    Size top = heap.top_page;
+    U8* big2 = heap_alloc(&heap, 32 * KiB, 16);
+    Test(big2 == big + 64 * KiB); /* Reuses the tail given back by the shrink */
+    heap_free(&heap, big2);
+    heap_free(&heap, big);
+    Test(heap.top_page <= top);
+
+    heap_free_all(&heap);
+    Test(heap.top_page == 0);
+    Test(heap_alloc(&heap, 10, 8) != NULL);
+
+    heap_destroy(&heap);
+    TEST_END;
+}
+
+static inline
+void allocator_test(){
+    TEST_BEGIN("Allocator");
+    static U8 memory[64 * KiB];
+    Arena arena = {0};
+    arena_init_buffer(&arena, memory, sizeof(memory));
+    Heap heap = {0};
+    heap_init(&heap, 16 * MiB);
+    Pool pool = {0};
+    pool_init(&pool, &arena, 32, 8);
+
+    Allocator allocators[] = {
+        arena_allocator(&arena),
+        heap_allocator(&heap),
+    };
+
+    for(Size i = 0; i < 2; i += 1){
+        Allocator al = allocators[i];
+        String s = str_concat(str_literal("Hello, "), str_literal("World"), al);
+        Test(str_eq(s, str_literal("Hello, World")) && s.v[s.len] == 0);
+
+        struct { I32* v; Size len; Size cap; Allocator allocator; } arr = { .allocator = al };
+        for(I32 n = 0; n < 1000; n += 1){
+            dyn_array_push(&arr, n);
+        }
+        bool all_ok = arr.len == 1000;
+        for(I32 n = 0; n < 1000; n += 1){
+            all_ok = all_ok && arr.v[n] == n;
+        }
+        Test(all_ok);
+    }
+
+    Allocator pa = pool_allocator(&pool);
+    void* p = mem_alloc(pa, 24, 8);
+    Test(p != NULL);
+    Test(mem_alloc(pa, 64, 8) == NULL);
+    mem_free(pa, p, 24);
+    Test(mem_alloc(pa, 32, 8) == p);
+
+    heap_destroy(&heap);
+    TEST_END;
+}
+
+typedef struct {
+    JobSystem* sys;
+    AtomicU64 sum;
+    AtomicU32 scratch_ok;
+} JobsTestData;
+
+static
+void jobs_test_sum(JobContext* ctx, void* data, Size begin, Size end){
+    JobsTestData* d = data;
+    U64* tmp = arena_push(ctx->scratch, U64, end - begin);
+    if(tmp == NULL){
+        atomic_store(&d->scratch_ok, 0);
+        return;
+    }
+    U64 acc = 0;
+    for(Size i = begin; i < end; i += 1){
+        tmp[i - begin] = i;
+        acc += tmp[i - begin];
+    }
+    atomic_fetch_add(&d->sum, acc);
+}
+
+static
+void jobs_test_spawn(JobContext* ctx, void* data, Size begin, Size end){
+    (void)ctx;
+    JobsTestData* d = data;
+    JobCounter counter = {0};
+    for(Size i = begin; i < end; i += 1){
+        jobs_push(d->sys, &counter, jobs_test_sum, d, i * 100, (i + 1) * 100);
+    }
+    jobs_wait(d->sys, &counter);
+}
+
+static inline
+void jobs_test(){
+    TEST_BEGIN("Jobs");
+    JobSystem sys = {0};
+    Test(jobs_init(&sys, 4));
+    Test(jobs_worker_index() == 0);
+
+    JobsTestData data = { .sys = &sys, .scratch_ok = 1 };
+    jobs_parallel_for(&sys, 100000, 1000, jobs_test_sum, &data);
+    Test(atomic_load(&data.sum) == (100000ull * 99999ull) / 2);
+    Test(atomic_load(&data.scratch_ok) == 1);
+
+    atomic_store(&data.sum, 0);
+    jobs_parallel_for(&sys, 100, 10, jobs_test_spawn, &data);
+    Test(atomic_load(&data.sum) == (10000ull * 9999ull) / 2);
+
+    jobs_destroy(&sys);
+    Test(jobs_worker_index() == -1);
+    TEST_END;
+}
+
+#define QUEUE_TEST_ITEMS 100000
+
+static
+void queue_test_spsc_producer(void* arg){
+    SpscQueue* q = arg;
+    for(Uintptr i = 1; i <= QUEUE_TEST_ITEMS; i += 1){
+        spsc_queue_push_wait(q, (void*)i);
+    }
+}
+
+typedef struct {
+    MpmcQueue* q;
+    AtomicU64 sum;
+} QueueTestData;
+
+static
+void queue_test_mpmc_producer(void* arg){
+    QueueTestData* d = arg;
+    for(Uintptr i = 1; i <= QUEUE_TEST_ITEMS; i += 1){
+        mpmc_queue_push_wait(d->q, (void*)i);
+    }
+}
+
+static
+void queue_test_mpmc_consumer(void* arg){
+    QueueTestData* d = arg;
+    U64 acc = 0;
+    for(Size i = 0; i < QUEUE_TEST_ITEMS; i += 1){
+        acc += (Uintptr)mpmc_queue_pop_wait(d->q);
+    }
+    atomic_fetch_add(&d->sum, acc);
+}
+
+static inline
+void queue_test(){
+    TEST_BEGIN("Queues");
+    static U8 memory[16 * KiB];
+    Arena arena = {0};
+    arena_init_buffer(&arena, memory, sizeof(memory));
+    const U64 expected = ((U64)QUEUE_TEST_ITEMS * (QUEUE_TEST_ITEMS + 1)) / 2;
+
+    SpscQueue spsc = {0};
+    Test(spsc_queue_init(&spsc, &arena, 60));
+    Test(spsc.mask == 63);
+
+    void* item = NULL;
+    Test(!spsc_queue_pop(&spsc, &item));
+
+    Thread producer = {0};
+    thread_create(&producer, queue_test_spsc_producer, &spsc);
+    U64 sum = 0;
+    bool in_order = true;
+    for(Uintptr i = 1; i <= QUEUE_TEST_ITEMS; i += 1){
+        Uintptr v = (Uintptr)spsc_queue_pop_wait(&spsc);
+        in_order = in_order && v == i;
+        sum += v;
+    }
+    thread_join(&producer);
+    Test(in_order && sum == expected);
+
+    MpmcQueue mpmc = {0};
+    Test(mpmc_queue_init(&mpmc, &arena, 64));
+    for(Uintptr i = 1; i <= 64; i += 1){
+        mpmc_queue_push(&mpmc, (void*)i);
+    }
+    Test(!mpmc_queue_push(&mpmc, (void*)1));
+    while(mpmc_queue_pop(&mpmc, &item)){}
+
+    QueueTestData data = { .q = &mpmc };
+    Thread threads[4] = {0};
+    thread_create(&threads[0], queue_test_mpmc_producer, &data);
+    thread_create(&threads[1], queue_test_mpmc_producer, &data);
+    thread_create(&threads[2], queue_test_mpmc_consumer, &data);
+    thread_create(&threads[3], queue_test_mpmc_consumer, &data);
+    for(Size i = 0; i < 4; i += 1){
+        thread_join(&threads[i]);
+    }
+    Test(atomic_load(&data.sum) == expected * 2);
+
+    TEST_END;
+}
+
+typedef struct {
+    ArenaPool* pool;
+    AtomicU32 failures;
+} ArenaPoolTestData;
+
+static
+void arena_pool_test_worker(void* arg){
+    ArenaPoolTestData* d = arg;
+    for(Size i = 0; i < 500; i += 1){
+        Arena* a = arena_pool_acquire_wait(d->pool);
+        bool reset = a->offset == 0;
+        U8* p = arena_alloc(a, 1000, 8);
+        if(p == NULL || !reset){ atomic_fetch_add(&d->failures, 1); }
+        else { mem_set(p, (U8)i, 1000); }
+        arena_pool_release(d->pool, a);
+    }
+}
+
+static inline
+void arena_pool_test(){
+    TEST_BEGIN("Arena Pool");
+    static U8 memory[8 * KiB];
+    Arena arena = {0};
+    arena_init_buffer(&arena, memory, sizeof(memory));
+
+    ArenaPool pool = {0};
+    Test(arena_pool_init(&pool, &arena, 3, 64 * MiB, 100 * KiB));
+    Test(pool.retain == 25 * VIRTUAL_PAGE_SIZE);
+
+    Arena* a = arena_pool_acquire(&pool);
+    Arena* b = arena_pool_acquire(&pool);
+    Arena* c = arena_pool_acquire(&pool);
+    Test(a && b && c && a != b && b != c);
+    Test(arena_pool_acquire(&pool) == NULL);
+    Test(a->data.commited >= pool.retain && a->offset == 0);
+
+    arena_alloc(a, 4 * MiB, 8);
+    arena_pool_release(&pool, a);
+    Test(a->offset == 0 && a->data.commited == pool.retain);
+    Test(arena_pool_acquire(&pool) == a);
+    arena_pool_release(&pool, a);
+    arena_pool_release(&pool, b);
+    arena_pool_release(&pool, c);
+
+    // More threads than arenas so acquire and release keep racing on the queue
+    ArenaPoolTestData data = { .pool = &pool };
+    bool all_idle = true;
+    for(Size round = 0; round < 20; round += 1){
+        Thread threads[6] = {0};
+        for(Size i = 0; i < 6; i += 1){
+            thread_create(&threads[i], arena_pool_test_worker, &data);
+        }
+        for(Size i = 0; i < 6; i += 1){
+            thread_join(&threads[i]);
+        }
+        Arena* idle[3] = {0};
+        for(Size i = 0; i < 3; i += 1){
+            idle[i] = arena_pool_acquire(&pool);
+            all_idle = all_idle && idle[i] != NULL;
+        }
+        all_idle = all_idle && arena_pool_acquire(&pool) == NULL;
+        for(Size i = 0; i < 3; i += 1){
+            if(idle[i]){ arena_pool_release(&pool, idle[i]); }
+        }
+    }
+    Test(atomic_load(&data.failures) == 0);
+    Test(all_idle);
+
+    arena_pool_destroy(&pool);
+    TEST_END;
+}
+
+static inline
+void numa_test(){
+    TEST_BEGIN("NUMA");
+    I32 nodes = virtual_numa_node_count();
+    Test(nodes >= 1);
+    Test(thread_numa_node() >= 0 && thread_numa_node() < nodes);
+
+    Arena arena = {0};
+    Test(arena_init_virtual(&arena, 16 * MiB));
+    Test(arena_bind_node(&arena, 0));
+    Test(!arena_bind_node(&arena, nodes));
+    Test(arena.numa_bound && arena.numa_node == 0);
+    mem_set(arena_alloc(&arena, 1 * MiB, 8), 1, 1 * MiB);
+    arena_destroy(&arena);
+
+    static U8 memory[64];
+    arena_init_buffer(&arena, memory, sizeof(memory));
+    Test(!arena_bind_node(&arena, 0));
+
+    ArenaPool pool = {0};
+    static U8 pool_memory[4 * KiB];
+    arena_init_buffer(&arena, pool_memory, sizeof(pool_memory));
+    Test(arena_pool_init_node(&pool, &arena, 2, 16 * MiB, 64 * KiB, nodes - 1));
+    Test(arena_pool_acquire(&pool)->numa_node == nodes - 1);
+    arena_pool_release(&pool, &pool.arenas[0]);
+    arena_pool_destroy(&pool);
+
+    JobSystem sys = {0};
+    Test(jobs_init_numa(&sys, 4));
+    JobsTestData data = { .sys = &sys };
+    jobs_parallel_for(&sys, 10000, 100, jobs_test_sum, &data);
+    Test(atomic_load(&data.sum) == (10000ull * 9999ull) / 2);
+    jobs_destroy(&sys);
+    TEST_END;
+}
+
+static inline
+void line_index_test(){
+    TEST_BEGIN("Line Index");
+    static U8 memory[4 * KiB];
+    Arena arena = {0};
+    arena_init_buffer(&arena, memory, sizeof(memory));
+
+    String src = str_literal("first line\nsecond line that is longer than 16 bytes\n\nl\xc3\xadne 4");
+    Test(str_count_newlines(src) == 3);
+
+    LineIndex index = {0};
+    Test(line_index_build(&index, src, arena_allocator(&arena)));
+    Test(index.len == 4);
+
+    SourceLocation loc = line_index_locate(&index, src, 0);
+    Test(loc.line == 1 && loc.column == 1);
+    loc = line_index_locate(&index, src, 18);
+    Test(loc.line == 2 && loc.column == 8);
+    loc = line_index_locate(&index, src, 52);
+    Test(loc.line == 3 && loc.column == 1);
+    loc = line_index_locate(&index, src, src.len - 1);
+    Test(loc.line == 4 && loc.column == 6);
+
+    TEST_END;
+}
+
+// Relexed tokens match a fresh tokenize of the same source
+static
+bool relex_matches(TokenArray const* arr, String source, Arena* scratch){
+    ArenaTemp tmp = arena_temp_begin(scratch);
+    TokenArray fresh = { .allocator = arena_allocator(scratch) };
+    Lexer lex = lexer_create(source, NULL);
+    bool ok = lexer_tokenize(&lex, &fresh) && fresh.len == arr->len;
+    for(Size i = 0; ok && i < fresh.len; i += 1){
+        ok = fresh.kind[i] == arr->kind[i]
+            && fresh.length[i] == arr->length[i]
+            && token_array_offset(&fresh, i) == token_array_offset(arr, i);
+    }
+    arena_temp_end(tmp);
+    return ok;
+}
+
+static inline
+void token_array_test(){
+    TEST_BEGIN("Token Array");
+    String src = str_literal("[1, \"two\", true]");
+    static I32 const KINDS[] = { TK_SquareOpen, TK_Number, TK_Comma, TK_String, TK_Comma, TK_True, TK_SquareClose, TK_EndOfFile };
+    static U64 const OFFSETS[] = { 0, 1, 2, 4, 9, 11, 15, 16 };
+    static Size const LENGTHS[] = { 1, 1, 1, 5, 1, 4, 1, 0 };
+
+    static U8 memory[1280];
+    Arena arena = {0};
+    arena_init_buffer(&arena, memory, sizeof(memory));
+    TokenArray arr = { .allocator = arena_allocator(&arena) };
+    bool push_ok = true;
+    for(Size i = 0; i < TOKEN_ARRAY_MIN_CAP; i += 1){
+        Size t = i % 8;
+        Token tk = { .lexeme = str_sub(src, OFFSETS[t], LENGTHS[t]), .offset = OFFSETS[t], .kind = KINDS[t] };
+        push_ok = push_ok && token_array_push(&arr, tk);
+    }
+    Test(push_ok);
+
+    // The second grow only has room for two of the arrays, none of them is replaced
+    TokenArray before = arr;
+    Test(!token_array_push(&arr, (Token){ .kind = TK_Comma }));
+    Test(arr.kind == before.kind && arr.offset == before.offset && arr.length == before.length);
+    Test(arr.len == TOKEN_ARRAY_MIN_CAP && arr.cap == TOKEN_ARRAY_MIN_CAP);
+
+    bool get_ok = true;
+    for(Size i = 0; i < arr.len; i += 1){
+        Token tk = token_array_get(&arr, src, i);
+        Size t = i % 8;
+        get_ok = get_ok && tk.kind == KINDS[t] && tk.offset == OFFSETS[t] && tk.lexeme.len == LENGTHS[t];
+    }
+    Test(get_ok);
+    Test(str_eq(token_array_get(&arr, src, 3).lexeme, str_literal("\"two\"")));
+    Test(token_array_count_kind(&arr, TK_Comma) == 16 && token_array_count_kind(&arr, TK_EndOfFile) == 8);
+    Test(token_array_count_kind(&arr, TK_Nil) == 0);
+
+    Token far = { .offset = (U64)UINT32_MAX + 1, .kind = TK_Number };
+    Test(!token_array_push(&arr, far));
+
+    Arena big = {0};
+    arena_init_virtual(&big, 64 * MiB);
+    TokenArray64 arr64 = { .allocator = arena_allocator(&big) };
+    Test(token_array64_push(&arr64, far));
+    for(Size i = 0; i < 200; i += 1){
+        Size t = i % 8;
+        Token tk = { .lexeme = str_sub(src, OFFSETS[t], LENGTHS[t]), .offset = OFFSETS[t], .kind = KINDS[t] };
+        push_ok = token_array64_push(&arr64, tk);
+    }
+    Test(push_ok && arr64.len == 201 && arr64.cap >= 201);
+    Test(arr64.offset[0] == far.offset && token_kind_decode(arr64.kind[200]) == TK_EndOfFile);
+    Token tk = token_array64_get(&arr64, src, 4);
+    Test(tk.kind == TK_String && tk.offset == 4 && str_eq(tk.lexeme, str_literal("\"two\"")));
+    arena_destroy(&big);
+    TEST_END;
+}
+
+static inline
+void lexer_relex_test(){
+    TEST_BEGIN("Lexer (Relex)");
+    Arena arena = {0}, scratch = {0};
+    arena_init_virtual(&arena, 64 * MiB);
+    arena_init_virtual(&scratch, 64 * MiB);
+
+    static char text[2][256];
+    I32 cur = 0;
+    String base = str_literal("{\"name\": \"abc def\", // note\n \"list\": [1, 2.5, true, nil]}");
+    mem_copy_no_overlap(text[cur], base.v, base.len);
+    Size len = base.len;
+
+    TokenArray arr = { .allocator = arena_allocator(&arena) };
+    Lexer lex = lexer_create(str_from_bytes((U8*)text[cur], len), NULL);
+    Test(lexer_tokenize(&lex, &arr));
+
+    // Applied in order, later edits land on tokens still carrying the shift of earlier ones
+    static const struct { Size offset; Size removed; char const* inserted; } EDITS[] = {
+        { 1, 0, "\"id\": 7, " },    // Insert
+        { 1, 9, "" },               // Delete
+        { 41, 3, "-12e3" },         // Replace
+        { 58, 1, ", \"x\"}" },      // At the end
+        { 24, 0, "\n" },            // Split the comment
+        { 12, 0, "\"" },            // Split the string
+        { 12, 1, "" },              // Join it back
+    };
+    for(Size e = 0; e < (Size)(sizeof(EDITS) / sizeof(EDITS[0])); e += 1){
+        Size offset = EDITS[e].offset, removed = EDITS[e].removed;
+        Size inserted = cstring_len(EDITS[e].inserted);
+        I32 next = 1 - cur;
+        mem_copy_no_overlap(text[next], text[cur], offset);
+        mem_copy_no_overlap(text[next] + offset, EDITS[e].inserted, inserted);
+        mem_copy_no_overlap(text[next] + offset + inserted, text[cur] + offset + removed, len - offset - removed);
+        len = len - removed + inserted;
+        cur = next;
+
+        String source = str_from_bytes((U8*)text[cur], len);
+        TextEdit edit = { .offset = offset, .removed = removed, .inserted = inserted };
+        Test(lexer_relex(&arr, source, edit, &scratch, NULL));
+        Test(relex_matches(&arr, source, &scratch));
+    }
+
+    token_array_flush(&arr);
+    Test(arr.shift_delta == 0);
+    Test(relex_matches(&arr, str_from_bytes((U8*)text[cur], len), &scratch));
+
+    arena_destroy(&scratch);
+    arena_destroy(&arena);
+    TEST_END;
+}
+
+static inline
+void doc_cache_test(){
+    TEST_BEGIN("Doc Cache");
+    Arena arena = {0};
+    arena_init_virtual(&arena, 64 * MiB);
+    DocCache cache = {0};
+    Test(doc_cache_init(&cache, arena_allocator(&arena), 3, 1 * MiB));
+
+    static char const* DOCS[] = { "{\"k\": 0}", "{\"k\": 1}", "{\"k\": 2}", "{\"k\": 3}" };
+    DocCacheEntry const* e[4] = {0};
+    for(Size i = 0; i < 3; i += 1){
+        e[i] = doc_cache_get(&cache, str_from(DOCS[i]));
+        Test(e[i] != NULL);
+    }
+    Test(cache.misses == 3 && cache.hits == 0 && e[1] != e[0]);
+
+    Size field = 0;
+    I64 value = -1;
+    Test(tape_find_field(&e[1]->tape, tape_root(&e[1]->tape), str_literal("k"), &field));
+    Test(tape_get_i64(&e[1]->tape, field, &value) && value == 1);
+    Test(e[1]->tokens.len == 5 && str_eq(e[1]->source, str_from(DOCS[1])));
+
+    // Hits compare content, not the caller's pointer
+    static char copy[16];
+    mem_copy_no_overlap(copy, DOCS[0], cstring_len(DOCS[0]) + 1);
+    Test(doc_cache_get(&cache, str_from(copy)) == e[0]);
+    Test(cache.hits == 1);
+
+    // Full, the least recently used one goes: 1, since 0 was just hit
+    e[3] = doc_cache_get(&cache, str_from(DOCS[3]));
+    Test(e[3] != NULL && cache.evictions == 1);
+    Test(cache.head >= 0 && &cache.entries[cache.head] == e[3]);
+    Test(cache.tail >= 0 && str_eq(cache.entries[cache.tail].source, str_from(DOCS[2])));
+    Test(doc_cache_get(&cache, str_from(DOCS[0])) == e[0] && cache.hits == 2);
+    doc_cache_get(&cache, str_from(DOCS[1]));
+    Test(cache.misses == 5 && cache.evictions == 2);
+
+    Test(doc_cache_get(&cache, str_literal("{\"k\": ")) == NULL);
+
+    doc_cache_clear(&cache);
+    Test(cache.used == 0 && cache.head == -1 && cache.tail == -1);
+    Size misses = cache.misses;
+    Test(doc_cache_get(&cache, str_from(DOCS[0])) != NULL && cache.misses == misses + 1);
+    doc_cache_destroy(&cache);
+
+    // Budget of two entries, each small document takes a page
+    Test(doc_cache_init(&cache, arena_allocator(&arena), 8, 2 * VIRTUAL_PAGE_SIZE));
+    for(Size i = 0; i < 3; i += 1){
+        Test(doc_cache_get(&cache, str_from(DOCS[i])) != NULL);
+    }
+    Test(cache.evictions == 1 && cache.used <= cache.budget);
+    Test(str_eq(cache.entries[cache.tail].source, str_from(DOCS[1])));
+
+    // A document bigger than the whole budget is never cached
+    static char big[4 * KiB];
+    big[0] = '[';
+    for(Size i = 1; i < (Size)sizeof(big) - 1; i += 2){ big[i] = '1'; big[i + 1] = ','; }
+    big[sizeof(big) - 2] = ']';
+    big[sizeof(big) - 1] = 0;
+    Size used = cache.used;
+    Test(doc_cache_get(&cache, str_from(big)) == NULL);
+    Test(cache.used == used && cache.evictions == 1);
+    doc_cache_destroy(&cache);
+
+    arena_destroy(&arena);
+    TEST_END;
+}
+
+static inline
+void ondemand_test(){
+    TEST_BEGIN("On Demand");
+    String src = str_literal("{\"id\": 7, \"skip\": {\"deep\": [[1], \"}\"]}, \"pi\": -3.5e-1, \"name\": \"a\\\"b\", \"list\": [1, 2.5, \"x\", nil]}");
+    JsonValue root = json_root(src);
+    Test(json_kind(root) == TK_CurlyOpen);
+
+    JsonValue v = {0};
+    I64 id = 0;
+    Test(json_find_field(root, str_literal("id"), &v) && json_get_i64(v, &id) && id == 7);
+
+    F64 pi = 0;
+    Test(json_find_field(root, str_literal("pi"), &v) && json_get_f64(v, &pi));
+    Test(pi == -0.35);
+    Test(!json_find_field(root, str_literal("deep"), &v)); /* Nested keys aren't fields of the root */
+    Test(!json_find_field(root, str_literal("missing"), &v));
+
+    String name = {0};
+    Test(json_find_field(root, str_literal("name"), &v) && json_get_string(v, &name));
+    Test(str_eq(name, str_literal("a\\\"b")));
+    Test(!json_get_f64(v, &pi));
+
+    JsonValue list = {0};
+    Test(json_find_field(root, str_literal("list"), &list));
+    JsonIterator it = json_array_iter(list);
+    I32 kinds[8] = {0};
+    Size count = 0;
+    while(count < 8 && json_array_next(&it, &v)){
+        kinds[count] = json_kind(v);
+        count += 1;
+    }
+    Test(count == 4 && !it.failed);
+    Test(kinds[0] == TK_Number && kinds[1] == TK_Number && kinds[2] == TK_String && kinds[3] == TK_Nil);
+
+    it = json_array_iter(json_root(str_literal("[]")));
+    Test(!json_array_next(&it, &v) && !it.failed);
+
+    // Malformed input
+    it = json_array_iter(json_root(str_literal("[1 2]")));
+    Test(json_array_next(&it, &v) && !json_array_next(&it, &v) && it.failed);
+    Test(!json_find_field(json_root(str_literal("[1]")), str_literal("a"), &v));
+    Test(!json_get_f64(json_root(str_literal("1e")), &pi));
+    Test(!json_get_string(json_root(str_literal("\"abc")), &name));
+    Test(!json_get_string(json_root(str_literal("\"ab\\\"")), &name));
+    Test(json_get_string(json_root(str_literal("\"ab\\\\\"")), &name) && name.len == 4);
+
+    // Number literals of any length
+    I64 big = 0;
+    F64 f = 0;
+    Test(json_get_f64(json_root(str_literal("0.100000000000000000000000000000000000000000000000000000000000000001")), &f) && f == 0.1);
+    JsonValue wide = json_root(str_literal("-123456789012345678901234567890123456789012345678901234567890123456789"));
+    Test(!json_get_i64(wide, &big));
+    Test(json_get_f64(wide, &f) && f == -123456789012345678901234567890123456789012345678901234567890123456789.0);
+    Test(json_get_f64(json_root(str_literal("0.0000000000000000000000000000000000000000000000000000000000000000025e2")), &f) && f == 2.5e-64);
+
+    // 2^53 + 1 is halfway between two doubles, digits far past the kept ones decide the rounding
+    static char halfway[1100];
+    Size len = 0;
+    for(char const* p = "9007199254740993."; *p; p += 1){ halfway[len++] = *p; }
+    while(len < 1000){ halfway[len++] = '0'; }
+    String down = str_from_bytes((U8*)halfway, len);
+    halfway[len++] = '1';
+    String up = str_from_bytes((U8*)halfway, len);
+    Test(json_get_f64(json_root(down), &f) && f == 9007199254740992.0);
+    Test(json_get_f64(json_root(up), &f) && f == 9007199254740994.0);
+    TEST_END;
+}
+
+// Sums integer matches
+static
+bool query_test_sum(void* data, JsonValue value){
+    I64 n = 0;
+    if(json_get_i64(value, &n)){ *(I64*)data += n; }
+    return true;
+}
+
+static inline
+void query_test(){
+    TEST_BEGIN("Query");
+    static U8 memory[16 * KiB];
+    Arena arena = {0};
+    arena_init_buffer(&arena, memory, sizeof(memory));
+    JsonValue root = json_root(str_literal("{\"a\": {\"b\": 5, \"c d\": 6}, \"items\": [{\"n\": 1}, {\"n\": 20}, {\"m\": 3}, {\"n\": 300}]}"));
+
+    JsonQuery q = {0};
+    JsonValue v = {0};
+    I64 n = 0;
+    Test(json_query_compile(&q, &arena, str_literal("$.a.b")) && q.len == 2);
+    Test(json_query_first(&q, root, &v) && json_get_i64(v, &n) && n == 5);
+    Test(json_query_compile(&q, &arena, str_literal("/a/b")));
+    Test(json_query_first(&q, root, &v) && json_get_i64(v, &n) && n == 5);
+    Test(json_query_compile(&q, &arena, str_literal("$['a']['c d']")));
+    Test(json_query_first(&q, root, &v) && json_get_i64(v, &n) && n == 6);
+
+    I64 sum = 0;
+    Test(json_query_compile(&q, &arena, str_literal("$.items[*].n")));
+    Test(json_query_run(&q, root, query_test_sum, &sum) == 3 && sum == 321);
+
+    Test(json_query_compile(&q, &arena, str_literal("$.items[1].n")));
+    Test(json_query_first(&q, root, &v) && json_get_i64(v, &n) && n == 20);
+    Test(json_query_compile(&q, &arena, str_literal("/items/3/n")));
+    Test(json_query_first(&q, root, &v) && json_get_i64(v, &n) && n == 300);
+
+    // Missing paths compile but don't match
+    static char const* MISSING[] = { "$.a.x", "$.items[4]", "$.a[0]", "$.items.n", "/a/b/c" };
+    for(Size i = 0; i < (Size)(sizeof(MISSING) / sizeof(MISSING[0])); i += 1){
+        Test(json_query_compile(&q, &arena, str_from(MISSING[i])));
+        Test(json_query_run(&q, root, query_test_sum, &sum) == 0);
+    }
+
+    static char const* MALFORMED[] = { "a.b", "$.", "$.a[", "$.a[x]", "$.a[-1]", "$['a'", "$[*", "/a~2" };
+    for(Size i = 0; i < (Size)(sizeof(MALFORMED) / sizeof(MALFORMED[0])); i += 1){
+        Test(!json_query_compile(&q, &arena, str_from(MALFORMED[i])));
+    }
+    TEST_END;
+}
+
+static inline
+void tape_test(){
+    TEST_BEGIN("Tape");
+    Arena arena = {0};
+    arena_init_virtual(&arena, 64 * MiB);
+    TapeBuilder builder = {0};
+    tape_builder_init(&builder, arena_allocator(&arena));
+    Test(tape_build(&builder, str_literal("{\"id\": 42, \"ratio\": 0.5, \"ok\": true, \"tags\": [\"a\", \"b\\n\", nil], \"sub\": {\"id\": -1}}")));
+
+    Size size = tape_image_size(&builder);
+    U8* image = (U8*)arena_push(&arena, U64, size / 8 + 2); /* Room to move it by 8 */
+    tape_image(&builder, image);
+
+    Tape tape = {0};
+    Test(tape_open(&tape, image, size));
+    Size root = tape_root(&tape), node = 0, sub = 0;
+    Test(tape_kind(&tape, root) == TN_Object && tape_len(&tape, root) == 5);
+
+    I64 id = 0;
+    F64 ratio = 0;
+    bool ok = false;
+    String tag = {0};
+    Test(tape_find_field(&tape, root, str_literal("id"), &node) && tape_get_i64(&tape, node, &id) && id == 42);
+    Test(tape_find_field(&tape, root, str_literal("ratio"), &node) && tape_get_f64(&tape, node, &ratio) && ratio == 0.5);
+    Test(tape_find_field(&tape, root, str_literal("ok"), &node) && tape_get_bool(&tape, node, &ok) && ok);
+    Test(tape_find_field(&tape, root, str_literal("tags"), &node) && tape_len(&tape, node) == 3);
+    Test(tape_array_at(&tape, node, 1, &node) && tape_get_string(&tape, node, &tag) && str_eq(tag, str_literal("b\\n")));
+    Test(tape_find_field(&tape, root, str_literal("sub"), &sub));
+    Test(tape_find_field_id(&tape, sub, tape_key_id(&tape, str_literal("id")), &node) && tape_get_i64(&tape, node, &id) && id == -1);
+    Test(str_eq(tape_key(&tape, node), str_literal("id")));
+    Test(tape_key_id(&tape, str_literal("missing")) == TAPE_NO_KEY);
+    Test(!tape_find_field(&tape, root, str_literal("missing"), &node));
+    Test(tape_next(&tape, root) == tape_next(&tape, sub));
+
+    // Images from another version, truncated or misaligned ones are rejected
+    TapeHeader* header = (TapeHeader*)image;
+    header->version += 1;
+    Test(!tape_open(&tape, image, size));
+    header->version -= 1;
+    Test(!tape_open(&tape, image, size - 8));
+    Test(!tape_open(&tape, image, (Size)sizeof(TapeHeader) - 1));
+    header->magic += 1;
+    Test(!tape_open(&tape, image, size));
+    header->magic -= 1;
+    mem_copy(image + 8, image, size);
+    Test(!tape_open(&tape, image + 4, size));
+    Test(tape_open(&tape, image + 8, size));
+
+    Test(!tape_build(&builder, str_literal("{\"a\": [1, 2}")));
+
+    // Number literals longer than 64 characters, the integer overflows I64
+    Test(tape_build(&builder, str_literal("[0.10000000000000000000000000000000000000000000000000000000000000001, 123456789012345678901234567890123456789012345678901234567890123456789]")));
+    size = tape_image_size(&builder);
+    image = (U8*)arena_push(&arena, U64, size / 8 + 1);
+    tape_image(&builder, image);
+    Test(tape_open(&tape, image, size) && tape_len(&tape, tape_root(&tape)) == 2);
+    Test(tape_array_at(&tape, tape_root(&tape), 0, &node) && tape_get_f64(&tape, node, &ratio) && ratio == 0.1);
+    Test(tape_array_at(&tape, tape_root(&tape), 1, &node) && tape_kind(&tape, node) == TN_Float);
+    Test(tape_get_f64(&tape, node, &ratio) && ratio == 123456789012345678901234567890123456789012345678901234567890123456789.0);
+    tape_builder_destroy(&builder);
+    arena_destroy(&arena);
+    TEST_END;
+}
+
+#define SCHEMA_TEST_FIELDS(X) X(I64, id) X(I32, count) X(F64, score) X(F32, ratio) X(bool, active) X(String, name)
+SCHEMA_DECLARE(SchemaTest, SCHEMA_TEST_FIELDS)
+SCHEMA_DEFINE(SchemaTest, SCHEMA_TEST_FIELDS)
+
+static inline
+void schema_test(){
+    TEST_BEGIN("Schema");
+    SchemaTest v = {0};
+    String src = str_literal("{\"name\": \"x\", \"extra\": {\"id\": 9, \"list\": [1, 2]}, \"id\": 7, \"count\": -3, \"score\": 1.5, \"ratio\": 2, \"active\": true, \"zz\": nil}");
+    Test(SchemaTest_decode(json_root(src), &v));
+    Test(v.id == 7 && v.count == -3 && v.score == 1.5 && v.ratio == 2.0f && v.active);
+    Test(str_eq(v.name, str_literal("x")));
+
+    // The last duplicate wins, missing fields keep their value
+    v = (SchemaTest){ .count = 11, .score = -1 };
+    Test(SchemaTest_decode(json_root(str_literal("{\"id\": 1, \"id\": 2, \"name\": \"a\", \"name\": \"b\"}")), &v));
+    Test(v.id == 2 && str_eq(v.name, str_literal("b")));
+    Test(v.count == 11 && v.score == -1 && !v.active);
+    Test(SchemaTest_decode(json_root(str_literal("{}")), &v) && v.id == 2);
+
+    // Keys differing only in a character must not alias a field
+    v = (SchemaTest){0};
+    Test(SchemaTest_decode(json_root(str_literal("{\"ie\": 5, \"idd\": 6, \"Id\": 7}")), &v) && v.id == 0);
+
+    Test(!SchemaTest_decode(json_root(str_literal("{\"id\": \"7\"}")), &v));
+    Test(!SchemaTest_decode(json_root(str_literal("{\"count\": 3000000000}")), &v));
+    Test(!SchemaTest_decode(json_root(str_literal("{\"active\": 1}")), &v));
+    Test(!SchemaTest_decode(json_root(str_literal("{\"id\": 1 \"count\": 2}")), &v));
+    TEST_END;
+}
+
+#if defined(TRACE_ENABLED)
+static
+void trace_test_thread(void* arg){
+    (void)arg;
+    trace_counter("trace_test_thread", 1);
+}
+
+// First event named `name` in an exported trace, names are compared with their escapes
+static
+bool trace_test_find(JsonValue events, String name, JsonValue* out){
+    JsonIterator it = json_array_iter(events);
+    JsonValue ev, v;
+    String s;
+    while(json_array_next(&it, &ev)){
+        if(json_find_field(ev, str_literal("name"), &v) && json_get_string(v, &s) && str_eq(s, name)){
+            *out = ev;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline
+void trace_test(){
+    TEST_BEGIN("Trace");
+    {
+        trace_zone("trace_test \"zone\"");
+        trace_counter("trace_test_negative", -5);
+        trace_counter("trace_test_min", INT64_MIN);
+    }
+
+    // Threads running one after the other share a buffer
+    Thread t;
+    Test(thread_create(&t, trace_test_thread, NULL));
+    thread_join(&t);
+    Size buffers = trace_buffer_count();
+    for(I32 i = 0; i < 8; i += 1){
+        Test(thread_create(&t, trace_test_thread, NULL));
+        thread_join(&t);
+    }
+    Test(trace_buffer_count() == buffers);
+
+    static U8 memory[4096];
+    Arena arena = {0};
+    arena_init_buffer(&arena, memory, sizeof(memory));
+    String path = str_literal("/tmp/_base_trace_test.json");
+    FileHandle f = {0};
+    FileWriter w = {0};
+    Test(file_open(&f, path, Write | Create));
+    Test(file_writer_init(&w, f, &arena, 1024));
+    Test(trace_export_chrome(&w));
+    file_close(f);
+
+    FileMapping m = {0};
+    Test(file_map(&m, path));
+    String json = str_from_bytes(m.data, m.len);
+    Test(str_starts_with(json, str_literal("{\"traceEvents\":[")) && str_ends_with(json, str_literal("]}\n")));
+
+    JsonValue events = {0}, ev = {0}, v = {0};
+    I64 n = 0;
+    F64 ts = 0, dur = -1;
+    String ph = {0};
+    Test(json_find_field(json_root(json), str_literal("traceEvents"), &events));
+    Test(trace_test_find(events, str_literal("trace_test \\\"zone\\\""), &ev));
+    Test(json_find_field(ev, str_literal("ph"), &v) && json_get_string(v, &ph) && str_eq(ph, str_literal("X")));
+    Test(json_find_field(ev, str_literal("ts"), &v) && json_get_f64(v, &ts) && ts > 0);
+    Test(json_find_field(ev, str_literal("dur"), &v) && json_get_f64(v, &dur) && dur >= 0);
+    Test(json_find_field(ev, str_literal("tid"), &v) && json_get_i64(v, &n) && n > 0);
+
+    Test(trace_test_find(events, str_literal("trace_test_negative"), &ev));
+    Test(json_find_field(ev, str_literal("ph"), &v) && json_get_string(v, &ph) && str_eq(ph, str_literal("C")));
+    Test(json_find_field(ev, str_literal("args"), &v) && json_find_field(v, str_literal("value"), &v));
+    Test(json_get_i64(v, &n) && n == -5);
+    Test(trace_test_find(events, str_literal("trace_test_min"), &ev));
+    Test(json_find_field(ev, str_literal("args"), &v) && json_find_field(v, str_literal("value"), &v));
+    Test(json_get_i64(v, &n) && n == INT64_MIN);
+    Test(trace_test_find(events, str_literal("trace_test_thread"), &ev));
+
+    file_unmap(&m);
+    TEST_END;
+}
+#endif
+
 #include <stdlib.h>
 int main(){
 	virtual_init();
+    memory_test();
     arena_buf_test();
     arena_virt_test();
+    arena_retention_test();
+    arena_chained_test();
+    #if defined(ARENA_DEBUG)
+    arena_debug_test();
+    #endif
+    #if defined(ARENA_STATS)
+    arena_stats_test();
+    #endif
+    file_writer_test();
+    pool_test();
+    heap_test();
+    allocator_test();
+    jobs_test();
+    queue_test();
+    arena_pool_test();
+    numa_test();
+    line_index_test();
+    string_builder_test();
+    hash_test();
+    token_array_test();
+    lexer_relex_test();
+    ondemand_test();
+    query_test();
+    tape_test();
+    schema_test();
+    doc_cache_test();
+    #if defined(TRACE_ENABLED)
+    trace_test();
+    #endif
 }
@@ -0,0 +1,57 @@
+#ifndef _thread_h_include_
+#define _thread_h_include_
+
+#include "base.h"
+
+typedef struct Thread Thread;
+
+typedef void (*ThreadFunc)(void* arg);
+
+// OS thread handle, must stay at the same address until thread_join returns
+struct Thread {
+	Uintptr    _v;
+	ThreadFunc func;
+	void*      arg;
+};
+
+// Start a thread running func(arg), returns success status
+bool thread_create(Thread* t, ThreadFunc func, void* arg);
+
+// Wait for thread to finish
+void thread_join(Thread* t);
+
+// Give up the rest of the time slice
+void thread_yield();
+
+// Number of logical processors available
+I32 thread_cpu_count();
+
+// Max CPU index thread_pin_numa_node can handle
+#define THREAD_MAX_CPUS 4096
+
+// NUMA node the calling thread is running on, 0 if it can't be told
+I32 thread_numa_node();
+
+// Restrict the calling thread to the CPUs of NUMA `node`. Does nothing on single node machines, returns success status
+bool thread_pin_numa_node(I32 node);
+
+// Sleep while *addr == expected, may return spuriously
+void futex_wait(AtomicU32* addr, U32 expected);
+
+// Wake one thread sleeping on addr
+void futex_wake_one(AtomicU32* addr);
+
+// Wake all threads sleeping on addr
+void futex_wake_all(AtomicU32* addr);
+
+// Hint to the CPU that we're in a spin loop
+static inline
+void cpu_relax(){
+	#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+	#elif defined(__aarch64__)
+	__asm__ __volatile__("yield");
+	#endif
+}
+
+#endif /* Include guard */
@@ -0,0 +1,117 @@
+#if defined(TARGET_OS_LINUX)
+#include "thread.h"
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include "virtual_memory.h"
+#include "trace.h"
+
+static
+void* thread_trampoline(void* arg){
+	Thread* t = arg;
+	t->func(t->arg);
+	trace_thread_exit();
+	return NULL;
+}
+
+bool thread_create(Thread* t, ThreadFunc func, void* arg){
+	t->func = func;
+	t->arg = arg;
+	pthread_t handle;
+	if(pthread_create(&handle, NULL, thread_trampoline, t) != 0){
+		return false;
+	}
+	t->_v = (Uintptr)handle;
+	return true;
+}
+
+void thread_join(Thread* t){
+	pthread_join((pthread_t)t->_v, NULL);
+}
+
+void thread_yield(){
+	sched_yield();
+}
+
+I32 thread_cpu_count(){
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (I32)n : 1;
+}
+
+I32 thread_numa_node(){
+	unsigned cpu = 0, node = 0;
+	if(syscall(SYS_getcpu, &cpu, &node, NULL) != 0){
+		return 0;
+	}
+	return (I32)node;
+}
+
+enum { THREAD_WORD_BITS = 8 * sizeof(unsigned long) };
+
+// Parse a sysfs CPU list ("0-3,8-11") into mask, returns false if nothing was set
+static
+bool thread_parse_cpulist(char const* buf, Size len, unsigned long* mask){
+	bool any = false;
+	I32 first = -1, value = -1;
+	for(Size i = 0; i <= len; i += 1){
+		char c = (i < len) ? buf[i] : ',';
+		if(c >= '0' && c <= '9'){
+			value = (value < 0 ? 0 : value * 10) + (c - '0');
+		}
+		else if(c == '-'){
+			first = value;
+			value = -1;
+		}
+		else if(value >= 0){
+			I32 lo = (first >= 0) ? first : value;
+			for(I32 cpu = lo; cpu <= value && cpu < THREAD_MAX_CPUS; cpu += 1){
+				mask[cpu / THREAD_WORD_BITS] |= 1ul << (cpu % THREAD_WORD_BITS);
+				any = true;
+			}
+			first = value = -1;
+		}
+	}
+	return any;
+}
+
+bool thread_pin_numa_node(I32 node){
+	if(node < 0 || node >= virtual_numa_node_count()){ return false; }
+	if(virtual_numa_node_count() == 1){ return true; }
+
+	// "/sys/devices/system/node/node<N>/cpulist"
+	char path[64] = "/sys/devices/system/node/node";
+	Size len = 29;
+	char digits[8];
+	Size n = 0;
+	do { digits[n++] = (char)('0' + node % 10); node /= 10; } while(node > 0);
+	while(n > 0){ path[len++] = digits[--n]; }
+	mem_copy_no_overlap(&path[len], "/cpulist", 9);
+
+	char buf[1024];
+	int fd = open(path, O_RDONLY);
+	if(fd < 0){ return false; }
+	ssize_t read_len = read(fd, buf, sizeof(buf));
+	close(fd);
+	if(read_len <= 0){ return false; }
+
+	unsigned long mask[THREAD_MAX_CPUS / THREAD_WORD_BITS] = {0};
+	if(!thread_parse_cpulist(buf, (Size)read_len, mask)){ return false; }
+	return syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask) == 0;
+}
+
+void futex_wait(AtomicU32* addr, U32 expected){
+	syscall(SYS_futex, (U32*)addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+void futex_wake_one(AtomicU32* addr){
+	syscall(SYS_futex, (U32*)addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+void futex_wake_all(AtomicU32* addr){
+	syscall(SYS_futex, (U32*)addr, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+#endif
@@ -0,0 +1,65 @@
+#if defined(TARGET_OS_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "thread.h"
+#include "trace.h"
+
+// WaitOnAddress lives in Synchronization.lib
+#pragma comment(lib, "Synchronization.lib")
+
+static
+DWORD WINAPI thread_trampoline(LPVOID arg){
+	Thread* t = arg;
+	t->func(t->arg);
+	trace_thread_exit();
+	return 0;
+}
+
+bool thread_create(Thread* t, ThreadFunc func, void* arg){
+	t->func = func;
+	t->arg = arg;
+	HANDLE handle = CreateThread(NULL, 0, thread_trampoline, t, 0, NULL);
+	if(handle == NULL){
+		return false;
+	}
+	t->_v = (Uintptr)handle;
+	return true;
+}
+
+void thread_join(Thread* t){
+	WaitForSingleObject((HANDLE)t->_v, INFINITE);
+	CloseHandle((HANDLE)t->_v);
+}
+
+void thread_yield(){
+	SwitchToThread();
+}
+
+I32 thread_cpu_count(){
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return info.dwNumberOfProcessors > 0 ? (I32)info.dwNumberOfProcessors : 1;
+}
+
+// NUMA placement is not implemented on Windows, see virtual_numa_node_count
+I32 thread_numa_node(){
+	return 0;
+}
+
+bool thread_pin_numa_node(I32 node){
+	return node == 0;
+}
+
+void futex_wait(AtomicU32* addr, U32 expected){
+	WaitOnAddress((volatile VOID*)addr, &expected, sizeof(expected), INFINITE);
+}
+
+void futex_wake_one(AtomicU32* addr){
+	WakeByAddressSingle((PVOID)addr);
+}
+
+void futex_wake_all(AtomicU32* addr){
+	WakeByAddressAll((PVOID)addr);
+}
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef _timing_h_include_
+#define _timing_h_include_
+
+#include "base.h"
+
+// Monotonic clock, in nanoseconds
+U64 time_now_ns();
+
+#endif /* Include guard */
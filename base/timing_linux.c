@@ -0,0 +1,11 @@
+#if defined(TARGET_OS_LINUX)
+#include "timing.h"
+#include <time.h>
+
+U64 time_now_ns(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (U64)ts.tv_sec * 1000000000ull + (U64)ts.tv_nsec;
+}
+
+#endif
@@ -0,0 +1,18 @@
+#if defined(TARGET_OS_WINDOWS)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include "timing.h"
+
+U64 time_now_ns(){
+	static LARGE_INTEGER frequency = {0};
+	if(frequency.QuadPart == 0){
+		QueryPerformanceFrequency(&frequency);
+	}
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	U64 seconds = counter.QuadPart / frequency.QuadPart;
+	U64 rest = counter.QuadPart % frequency.QuadPart;
+	return seconds * 1000000000ull + (rest * 1000000000ull) / frequency.QuadPart;
+}
+
+#endif
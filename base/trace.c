@@ -0,0 +1,200 @@
+#include "trace.h"
+
+#if defined(TRACE_ENABLED)
+#include "virtual_memory.h"
+#include "memory.h"
+#include "strings.h"
+
+static_assert((TRACE_BUFFER_EVENTS & (TRACE_BUFFER_EVENTS - 1)) == 0, "Trace buffer size must be a power of 2");
+static_assert(sizeof(TraceEvent) % sizeof(Uintptr) == 0, "Trace events must be made of whole words");
+
+static TraceBuffer* _Atomic trace_registry = NULL;
+static AtomicSize trace_buffer_total = 0;
+static AtomicU32 trace_thread_counter = 0;
+static _Thread_local TraceBuffer* trace_local_buffer = NULL;
+static _Thread_local U32 trace_local_thread_id = 0;
+
+// Uses virtual_reserve/virtual_commit directly, virtual_block_push is traced.
+static
+TraceBuffer* trace_buffer_create(){
+	Size size = align_forward_size(sizeof(TraceBuffer) + sizeof(TraceEvent) * TRACE_BUFFER_EVENTS, VIRTUAL_PAGE_SIZE);
+	static_assert(alignof(TraceEvent) <= alignof(AtomicUintptr), "Event words must be aligned like the events");
+	U8* mem = virtual_reserve(size);
+	if(mem == NULL || virtual_commit(mem, size) == NULL){
+		return NULL;
+	}
+
+	TraceBuffer* buf = (TraceBuffer*)mem;
+	buf->events = (void*)(mem + align_forward_size(sizeof(TraceBuffer), alignof(AtomicUintptr)));
+	atomic_store_explicit(&buf->in_use, 1, memory_order_relaxed);
+	atomic_store_explicit(&buf->head, 0, memory_order_relaxed);
+
+	TraceBuffer* old_head = atomic_load(&trace_registry);
+	do {
+		buf->next = old_head;
+	} while(!atomic_compare_exchange_weak(&trace_registry, &old_head, buf));
+	atomic_fetch_add_explicit(&trace_buffer_total, 1, memory_order_relaxed);
+
+	return buf;
+}
+
+// Take over the buffer of an exited thread, or map a new one
+static
+TraceBuffer* trace_buffer_acquire(){
+	for(TraceBuffer* buf = atomic_load(&trace_registry); buf != NULL; buf = buf->next){
+		U32 free = 0;
+		if(atomic_load_explicit(&buf->in_use, memory_order_relaxed) == 0 &&
+		   atomic_compare_exchange_strong_explicit(&buf->in_use, &free, 1, memory_order_acquire, memory_order_relaxed))
+		{
+			return buf;
+		}
+	}
+	return trace_buffer_create();
+}
+
+void trace_thread_exit(){
+	TraceBuffer* buf = trace_local_buffer;
+	if(buf != NULL){
+		trace_local_buffer = NULL;
+		atomic_store_explicit(&buf->in_use, 0, memory_order_release);
+	}
+}
+
+Size trace_buffer_count(){
+	return atomic_load_explicit(&trace_buffer_total, memory_order_relaxed);
+}
+
+static inline
+void trace_push(TraceEvent ev){
+	TraceBuffer* buf = trace_local_buffer;
+	if(hint_unlikely(buf == NULL)){
+		buf = trace_local_buffer = trace_buffer_acquire();
+		if(buf == NULL){ return; }
+		if(trace_local_thread_id == 0){
+			trace_local_thread_id = atomic_fetch_add(&trace_thread_counter, 1) + 1;
+		}
+	}
+	ev.thread_id = trace_local_thread_id;
+	U64 head = atomic_load_explicit(&buf->head, memory_order_relaxed);
+	Uintptr words[TRACE_EVENT_WORDS];
+	mem_copy_no_overlap(words, &ev, sizeof(ev));
+
+	// Orders the previous head before the slot is overwritten, see trace_export_chrome
+	atomic_thread_fence(memory_order_release);
+	AtomicUintptr* slot = buf->events[head & (TRACE_BUFFER_EVENTS - 1)];
+	for(Size i = 0; i < (Size)TRACE_EVENT_WORDS; i += 1){
+		atomic_store_explicit(&slot[i], words[i], memory_order_relaxed);
+	}
+	atomic_store_explicit(&buf->head, head + 1, memory_order_release);
+}
+
+void trace_zone_end(TraceZone* zone){
+	U64 end = time_now_ns();
+	trace_push((TraceEvent){
+		.name = zone->name,
+		.begin = zone->begin,
+		.end = end,
+		.kind = TraceEvent_Zone,
+	});
+}
+
+void trace_counter_sample(char const* name, I64 value){
+	trace_push((TraceEvent){
+		.name = name,
+		.begin = time_now_ns(),
+		.end = (U64)value,
+		.kind = TraceEvent_Counter,
+	});
+}
+
+static
+bool trace_write_u64(FileWriter* w, U64 n){
+	U8 digits[20];
+	Size len = 0;
+	do {
+		digits[sizeof(digits) - 1 - len] = '0' + (n % 10);
+		n /= 10;
+		len += 1;
+	} while(n > 0);
+	return file_writer_write(w, str_from_bytes(&digits[sizeof(digits) - len], len));
+}
+
+// Timestamps in microseconds with nanosecond fraction
+static
+bool trace_write_time(FileWriter* w, U64 ns){
+	U8 frac[4] = { '.', '0' + (ns / 100) % 10, '0' + (ns / 10) % 10, '0' + ns % 10 };
+	trace_write_u64(w, ns / 1000);
+	return file_writer_write(w, str_from_bytes(frac, 4));
+}
+
+static
+bool trace_write_name(FileWriter* w, char const* name){
+	String s = str_from(name);
+	for(Size i = 0; i < s.len; i += 1){
+		if(s.v[i] == '"' || s.v[i] == '\\'){
+			file_writer_write(w, str_sub(s, 0, i));
+			file_writer_write(w, str_literal("\\"));
+			s = str_sub(s, i, s.len - i);
+			i = 0;
+		}
+	}
+	return file_writer_write(w, s);
+}
+
+bool trace_export_chrome(FileWriter* w){
+	file_writer_write(w, str_literal("{\"traceEvents\":[\n"));
+
+	bool first = true;
+	for(TraceBuffer* buf = atomic_load(&trace_registry); buf != NULL; buf = buf->next){
+		U64 head = atomic_load_explicit(&buf->head, memory_order_acquire);
+		U64 start = head > TRACE_BUFFER_EVENTS ? head - TRACE_BUFFER_EVENTS : 0;
+
+		for(U64 i = start; i < head; i += 1){
+			// Copy the slot, then check the writer hasn't started on the event
+			// that replaces it, seqlock style
+			Uintptr words[TRACE_EVENT_WORDS];
+			AtomicUintptr* slot = buf->events[i & (TRACE_BUFFER_EVENTS - 1)];
+			for(Size k = 0; k < (Size)TRACE_EVENT_WORDS; k += 1){
+				words[k] = atomic_load_explicit(&slot[k], memory_order_relaxed);
+			}
+			atomic_thread_fence(memory_order_acquire);
+			if(atomic_load_explicit(&buf->head, memory_order_relaxed) - i >= TRACE_BUFFER_EVENTS){
+				continue; /* Overwritten */
+			}
+			TraceEvent ev;
+			mem_copy_no_overlap(&ev, words, sizeof(ev));
+
+			if(!first){ file_writer_write(w, str_literal(",\n")); }
+			first = false;
+
+			file_writer_write(w, str_literal("{\"name\":\""));
+			trace_write_name(w, ev.name);
+			if(ev.kind == TraceEvent_Zone){
+				file_writer_write(w, str_literal("\",\"ph\":\"X\",\"ts\":"));
+				trace_write_time(w, ev.begin);
+				file_writer_write(w, str_literal(",\"dur\":"));
+				trace_write_time(w, ev.end - ev.begin);
+			}
+			else {
+				file_writer_write(w, str_literal("\",\"ph\":\"C\",\"ts\":"));
+				trace_write_time(w, ev.begin);
+				file_writer_write(w, str_literal(",\"args\":{\"value\":"));
+				U64 magnitude = ev.end;
+				if((I64)ev.end < 0){
+					file_writer_write(w, str_literal("-"));
+					magnitude = (U64)0 - ev.end; /* Also right for INT64_MIN */
+				}
+				trace_write_u64(w, magnitude);
+				file_writer_write(w, str_literal("}"));
+			}
+			file_writer_write(w, str_literal(",\"pid\":1,\"tid\":"));
+			trace_write_u64(w, ev.thread_id);
+			file_writer_write(w, str_literal("}"));
+		}
+	}
+
+	file_writer_write(w, str_literal("\n]}\n"));
+	return file_writer_flush(w);
+}
+
+#endif
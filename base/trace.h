@@ -0,0 +1,96 @@
+#ifndef _trace_h_include_
+#define _trace_h_include_
+
+#include "base.h"
+#include "filesystem.h"
+
+// Instrumentation is only compiled in when TRACE_ENABLED is defined, otherwise
+// all trace_* macros expand to nothing.
+
+#if defined(TRACE_ENABLED)
+#include "timing.h"
+
+// Events per thread, older events get overwritten when the ring is full
+#define TRACE_BUFFER_EVENTS (64 * 1024)
+
+typedef struct TraceEvent TraceEvent;
+typedef struct TraceBuffer TraceBuffer;
+typedef struct TraceZone TraceZone;
+
+typedef enum TraceEventKind TraceEventKind;
+
+enum TraceEventKind {
+	TraceEvent_Zone    = 0,
+	TraceEvent_Counter = 1,
+};
+
+struct TraceEvent {
+	char const* name;
+	U64 begin;
+	U64 end;       // Counters store their value here
+	U32 thread_id; // Buffers change hands, so every event names its thread
+	U8  kind;
+};
+
+// Words of a TraceEvent, ring slots are accessed word by word with relaxed atomics
+#define TRACE_EVENT_WORDS (sizeof(TraceEvent) / sizeof(Uintptr))
+
+// Single writer ring buffer, owned by one thread at a time. When a thread
+// exits its buffer goes to the next thread that starts tracing, the events
+// it holds are kept until they are overwritten.
+struct TraceBuffer {
+	TraceBuffer*   next;   // Registry of all buffers
+	AtomicU32      in_use;
+	AtomicU64      head;   // Total events ever written
+	AtomicUintptr (*events)[TRACE_EVENT_WORDS];
+};
+
+struct TraceZone {
+	char const* name;
+	U64 begin;
+};
+
+static inline
+TraceZone trace_zone_begin(char const* name){
+	return (TraceZone){ .name = name, .begin = time_now_ns() };
+}
+
+// Record a finished zone
+void trace_zone_end(TraceZone* zone);
+
+// Record a counter sample
+void trace_counter_sample(char const* name, I64 value);
+
+#define _trace_concat_(A, B) A##B
+#define _trace_concat(A, B) _trace_concat_(A, B)
+
+// Time the rest of the enclosing scope
+#define trace_zone(Name) \
+	TraceZone _trace_concat(_trace_zone_, __LINE__) __attribute__((cleanup(trace_zone_end))) = trace_zone_begin(Name)
+
+#define trace_counter(Name, Value) trace_counter_sample((Name), (Value))
+
+// Hand the calling thread's buffer back for reuse, called by threads started
+// with thread_create when they return
+void trace_thread_exit();
+
+// Number of buffers mapped so far, at most the number of threads tracing at once
+Size trace_buffer_count();
+
+// Write events of all threads as Chrome trace-event JSON (chrome://tracing,
+// Perfetto). Traced threads may keep running, events they overwrite while
+// the export reads them are left out.
+bool trace_export_chrome(FileWriter* w);
+
+#else
+
+#define trace_zone(Name)
+#define trace_counter(Name, Value)
+#define trace_thread_exit()
+
+static inline
+bool trace_export_chrome(FileWriter* w){ (void)w; return false; }
+
+#endif
+
+#endif /* Include guard */
@@ -3,6 +3,7 @@
 
 #if defined(TARGET_OS_LINUX) || defined(TARGET_OS_WINDOWS)
 #include "virtual_memory.h"
+#include "trace.h"
 
 MemoryBlock virtual_block_create(Size reserve){
 	reserve = align_forward_size(reserve, VIRTUAL_PAGE_SIZE);
@@ -20,6 +21,7 @@ void virtual_block_destroy(MemoryBlock* block){
 }
 
 void* virtual_block_push(MemoryBlock* block, Size count){
+	trace_zone("virtual_block_push");
 	count = align_forward_size(count, VIRTUAL_PAGE_SIZE);
 	U8* old_ptr = block->ptr + block->commited;
 	void* new_ptr = virtual_commit(old_ptr, count);
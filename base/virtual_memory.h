@@ -43,6 +43,19 @@ void virtual_free(void* ptr, Size len);
 
 void virtual_decommit(void* ptr, Size len);
 
+// Drop the contents of committed pages now instead of when the OS needs memory
+void virtual_purge(void* ptr, Size len);
+
+// Max NUMA nodes virtual_bind_node can target
+#define VIRTUAL_MAX_NUMA_NODES 1024
+
+// Number of NUMA nodes, 1 on single node machines or if it can't be told
+I32 virtual_numa_node_count();
+
+// Place the pages of a range on NUMA `node`, pages already touched are migrated.
+// Does nothing on single node machines, returns false if the node doesn't exist or binding failed
+bool virtual_bind_node(void* ptr, Size len, I32 node);
+
 void* virtual_commit(void* ptr, Size len);
 
 
@@ -1,8 +1,14 @@
 #if defined(TARGET_OS_LINUX)
 #include "virtual_memory.h"
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
 #include <unistd.h>
 
+// From <numaif.h>, which needs libnuma
+#define VIRTUAL_MPOL_BIND 2
+#define VIRTUAL_MPOL_MF_MOVE (1 << 1)
+
 void virtual_init(){
 	static bool initialized = false;
 	if(!initialized){
@@ -33,11 +39,64 @@ void virtual_decommit(void* ptr, Size len){
 	madvise(ptr, len, MADV_FREE);
 }
 
+void virtual_purge(void* ptr, Size len){
+	ensure(((Uintptr)ptr & (VIRTUAL_PAGE_SIZE - 1)) == 0, "Pointer is not aligned to page boundary");
+	madvise(ptr, len, MADV_DONTNEED);
+}
+
 void virtual_free(void* ptr, Size len){
 	ensure(((Uintptr)ptr & (VIRTUAL_PAGE_SIZE - 1)) == 0, "Pointer is not aligned to page boundary");
 	munmap(ptr, len);
 }
 
+static AtomicU32 virtual_numa_nodes = 0; /* 0: unknown */
+
+// Highest node in a sysfs node list ("0", "0-1", "0,2-3") plus one
+static
+I32 virtual_read_node_count(char const* path){
+	char buf[256];
+	int fd = open(path, O_RDONLY);
+	if(fd < 0){ return 1; }
+	ssize_t n = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+
+	I32 count = 1;
+	I32 value = 0;
+	for(ssize_t i = 0; i < n; i += 1){
+		if(buf[i] >= '0' && buf[i] <= '9'){
+			value = value * 10 + (buf[i] - '0');
+			count = max(count, value + 1);
+		}
+		else {
+			value = 0;
+		}
+	}
+	return min(count, VIRTUAL_MAX_NUMA_NODES);
+}
+
+I32 virtual_numa_node_count(){
+	U32 count = atomic_load_explicit(&virtual_numa_nodes, memory_order_relaxed);
+	if(hint_unlikely(count == 0)){
+		count = (U32)virtual_read_node_count("/sys/devices/system/node/online");
+		atomic_store_explicit(&virtual_numa_nodes, count, memory_order_relaxed);
+	}
+	return (I32)count;
+}
+
+bool virtual_bind_node(void* ptr, Size len, I32 node){
+	I32 count = virtual_numa_node_count();
+	if(node < 0 || node >= count){ return false; }
+	if(count == 1){ return true; }
+
+	enum { WORD_BITS = 8 * sizeof(unsigned long) };
+	unsigned long mask[VIRTUAL_MAX_NUMA_NODES / WORD_BITS] = {0};
+	mask[node / WORD_BITS] = 1ul << (node % WORD_BITS);
+	Uintptr begin = (Uintptr)ptr & ~(Uintptr)(VIRTUAL_PAGE_SIZE - 1);
+	Size span = align_forward_size((Size)((Uintptr)ptr + len - begin), VIRTUAL_PAGE_SIZE);
+	long r = syscall(SYS_mbind, begin, span, VIRTUAL_MPOL_BIND, mask, VIRTUAL_MAX_NUMA_NODES, VIRTUAL_MPOL_MF_MOVE);
+	return r == 0;
+}
+
 static inline
 U32 _virtual_protect_flags(U8 prot){
 	U32 flag = 0;
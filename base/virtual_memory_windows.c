@@ -18,7 +18,7 @@ void* virtual_reserve(Size len){
 }
 
 bool virtual_protect(void* ptr, Size len, U8 prot){
-	U32 flags = 0;
+	U32 flags = PAGE_NOACCESS;
 
 	switch(prot){
 		case MemoryProtection_Read:
@@ -37,12 +37,8 @@ bool virtual_protect(void* ptr, Size len, U8 prot){
 			flags = PAGE_EXECUTE_READWRITE;
 		break;
 	}
-	if(flags == 0){
-		return NULL;
-	}
-
-	VirtualAlloc(ptr, len, MEM_COMMIT, flags);
-	return false;
+	DWORD old_flags = 0;
+	return VirtualProtect(ptr, len, flags, &old_flags) != 0;
 }
 
 void virtual_free(void* ptr, Size len){
@@ -56,9 +52,26 @@ void virtual_decommit(void* ptr, Size len){
 	VirtualFree(ptr, len, MEM_DECOMMIT);
 }
 
+// NUMA placement is not implemented, Windows places pages near the thread that first touches them
+I32 virtual_numa_node_count(){
+	return 1;
+}
+
+bool virtual_bind_node(void* ptr, Size len, I32 node){
+	(void)ptr;
+	(void)len;
+	return node == 0;
+}
+
+// Decommitting already gives the pages back
+void virtual_purge(void* ptr, Size len){
+	(void)ptr;
+	(void)len;
+}
+
 void* virtual_commit(void* ptr, Size len){
 	ensure(((Uintptr)ptr & (VIRTUAL_PAGE_SIZE - 1)) == 0, "Pointer is not aligned to page boundary");
-	VirtualAlloc(ptr, len, MEM_COMMIT, PAGE_READWRITE);
+	return VirtualAlloc(ptr, len, MEM_COMMIT, PAGE_READWRITE);
 }
 
 #endif
@@ -0,0 +1,164 @@
+#include "doc_cache.h"
+#include "base/memory.h"
+#include "base/hash.h"
+
+// 0 marks free slots
+static inline
+U64 doc_cache_hash(String source){
+	U64 h = hash_str_local(source, 0);
+	return h == 0 ? 1 : h;
+}
+
+static
+void doc_cache_unlink(DocCache* c, I32 i){
+	DocCacheEntry* e = &c->entries[i];
+	if(e->prev >= 0){ c->entries[e->prev].next = e->next; } else { c->head = e->next; }
+	if(e->next >= 0){ c->entries[e->next].prev = e->prev; } else { c->tail = e->prev; }
+	e->prev = e->next = -1;
+}
+
+static
+void doc_cache_push_front(DocCache* c, I32 i){
+	DocCacheEntry* e = &c->entries[i];
+	e->prev = -1;
+	e->next = c->head;
+	if(c->head >= 0){ c->entries[c->head].prev = i; } else { c->tail = i; }
+	c->head = i;
+}
+
+static
+void doc_cache_evict(DocCache* c, I32 i){
+	DocCacheEntry* e = &c->entries[i];
+	doc_cache_unlink(c, i);
+	arena_destroy(&e->arena);
+	c->used -= e->size;
+	c->hashes[i] = 0;
+	*e = (DocCacheEntry){ .prev = -1, .next = -1 };
+	c->evictions += 1;
+}
+
+bool doc_cache_init(DocCache* c, Allocator allocator, Size max_entries, Size budget){
+	if(max_entries <= 0 || max_entries > INT32_MAX || budget <= 0){ return false; }
+	*c = (DocCache){
+		.cap = max_entries,
+		.budget = budget,
+		.head = -1,
+		.tail = -1,
+		.tokens = { .allocator = allocator },
+		.allocator = allocator,
+	};
+	tape_builder_init(&c->builder, allocator);
+	c->entries = mem_alloc(allocator, max_entries * sizeof(DocCacheEntry), alignof(DocCacheEntry));
+	c->hashes = mem_alloc(allocator, max_entries * sizeof(U64), alignof(U64));
+	if(c->entries == NULL || c->hashes == NULL){
+		doc_cache_destroy(c);
+		return false;
+	}
+	for(Size i = 0; i < max_entries; i += 1){
+		c->entries[i] = (DocCacheEntry){ .prev = -1, .next = -1 };
+		c->hashes[i] = 0;
+	}
+	return true;
+}
+
+void doc_cache_destroy(DocCache* c){
+	if(c->entries != NULL && c->hashes != NULL){
+		doc_cache_clear(c);
+	}
+	tape_builder_destroy(&c->builder);
+	mem_free(c->allocator, c->tokens.kind, c->tokens.cap);
+	mem_free(c->allocator, c->tokens.offset, c->tokens.cap * sizeof(U32));
+	mem_free(c->allocator, c->tokens.length, c->tokens.cap * sizeof(U32));
+	mem_free(c->allocator, c->entries, c->cap * sizeof(DocCacheEntry));
+	mem_free(c->allocator, c->hashes, c->cap * sizeof(U64));
+	*c = (DocCache){ .head = -1, .tail = -1 };
+}
+
+void doc_cache_clear(DocCache* c){
+	while(c->tail >= 0){
+		doc_cache_evict(c, c->tail);
+	}
+}
+
+static
+DocCacheEntry const* doc_cache_insert(DocCache* c, String source, U64 hash){
+	c->tokens.len = 0;
+	Lexer lex = lexer_create(source, NULL);
+	if(!lexer_tokenize(&lex, &c->tokens) || !tape_build(&c->builder, source)){
+		return NULL;
+	}
+
+	// Everything is 8 byte aligned, the padding is bounded by the slack
+	Size image_size = tape_image_size(&c->builder);
+	Size token_count = c->tokens.len;
+	Size needed = image_size + source.len + token_count * (1 + 2 * sizeof(U32)) + 4 * 8;
+	Size size = align_forward_size(needed, VIRTUAL_PAGE_SIZE);
+	if(size > c->budget){ return NULL; }
+
+	while(c->tail >= 0 && c->used + size > c->budget){
+		doc_cache_evict(c, c->tail);
+	}
+
+	I32 slot = -1;
+	for(Size i = 0; i < c->cap; i += 1){
+		if(c->hashes[i] == 0){ slot = (I32)i; break; }
+	}
+	if(slot < 0){
+		slot = c->tail;
+		doc_cache_evict(c, slot);
+	}
+
+	DocCacheEntry* e = &c->entries[slot];
+	if(!arena_init_virtual(&e->arena, size)){ return NULL; }
+
+	U8* image = arena_push(&e->arena, U8, image_size);
+	U8* text = arena_push(&e->arena, U8, source.len);
+	U8* kind = arena_push(&e->arena, U8, token_count);
+	U32* offset = arena_push(&e->arena, U32, token_count);
+	U32* length = arena_push(&e->arena, U32, token_count);
+	if(image == NULL || text == NULL || kind == NULL || offset == NULL || length == NULL){
+		arena_destroy(&e->arena);
+		*e = (DocCacheEntry){ .prev = -1, .next = -1 };
+		return NULL;
+	}
+
+	tape_image(&c->builder, image);
+	tape_open(&e->tape, image, image_size);
+	mem_copy_no_overlap(text, source.v, source.len);
+	mem_copy_no_overlap(kind, c->tokens.kind, token_count);
+	mem_copy_no_overlap(offset, c->tokens.offset, token_count * sizeof(U32));
+	mem_copy_no_overlap(length, c->tokens.length, token_count * sizeof(U32));
+
+	e->source = str_from_bytes(text, source.len);
+	e->tokens = (TokenArray){
+		.kind = kind,
+		.offset = offset,
+		.length = length,
+		.len = token_count,
+		.cap = token_count,
+	};
+	e->hash = hash;
+	e->size = size;
+	c->hashes[slot] = hash;
+	c->used += size;
+	doc_cache_push_front(c, slot);
+	return e;
+}
+
+DocCacheEntry const* doc_cache_get(DocCache* c, String source){
+	U64 hash = doc_cache_hash(source);
+	for(Size i = 0; i < c->cap; i += 1){
+		if(c->hashes[i] != hash){ continue; }
+		DocCacheEntry* e = &c->entries[i];
+		if(e->source.len == source.len && mem_compare(e->source.v, source.v, source.len) == 0){
+			if(c->head != (I32)i){
+				doc_cache_unlink(c, (I32)i);
+				doc_cache_push_front(c, (I32)i);
+			}
+			c->hits += 1;
+			return e;
+		}
+	}
+	c->misses += 1;
+	return doc_cache_insert(c, source, hash);
+}
@@ -0,0 +1,67 @@
+#ifndef _doc_cache_h_include_
+#define _doc_cache_h_include_
+
+#include "base/base.h"
+#include "base/strings.h"
+#include "base/allocator.h"
+#include "base/arena.h"
+#include "lexer.h"
+#include "tape.h"
+
+// Cache of parsed documents keyed by their content. Every entry owns an arena
+// holding a copy of the source, its tokens and its tape, entries are evicted
+// least recently used first to stay under a byte budget. Lookups hash the
+// source and compare it against the candidate, so a hit never returns the
+// result of a different document.
+//
+// Entries are found with a linear scan over their hashes, the cache is meant
+// for a few dozen hot documents, not as a general purpose map.
+
+typedef struct DocCache DocCache;
+typedef struct DocCacheEntry DocCacheEntry;
+
+struct DocCacheEntry {
+	String     source; // Copy owned by the entry
+	TokenArray tokens; // Exact fit, can't be pushed to
+	Tape       tape;
+
+	Arena arena;
+	U64   hash;
+	Size  size;        // Bytes reserved in the arena, counted against the budget
+	I32   prev;        // LRU list, -1 terminated
+	I32   next;
+};
+
+struct DocCache {
+	DocCacheEntry* entries;
+	U64* hashes;       // Hash of every slot, 0 is free
+	Size cap;
+	Size budget;
+	Size used;
+	I32  head;         // Most recently used
+	I32  tail;         // Least recently used
+
+	TokenArray  tokens; // Staging for misses
+	TapeBuilder builder;
+	Allocator   allocator;
+
+	Size hits;
+	Size misses;
+	Size evictions;
+};
+
+// Initialize cache with room for `max_entries` documents using at most `budget` bytes, returns false on allocation failure
+bool doc_cache_init(DocCache* c, Allocator allocator, Size max_entries, Size budget);
+
+// Release every entry and the cache itself
+void doc_cache_destroy(DocCache* c);
+
+// Get the parsed form of `source`, parsing and inserting it on a miss. The entry
+// stays valid until the next doc_cache_get or doc_cache_clear. Returns null on
+// malformed input, allocation failure, or if the document alone is over budget
+DocCacheEntry const* doc_cache_get(DocCache* c, String source);
+
+// Evict every entry
+void doc_cache_clear(DocCache* c);
+
+#endif /* Include guard */
@@ -0,0 +1,409 @@
+#include "lexer.h"
+#include "base/memory.h"
+#include "base/trace.h"
+
+static const String ERROR_MESSAGES[EK__Count] = {
+	[EK_None]                = str_literal("No error"),
+	[EK_UnterminatedString]  = str_literal("Unterminated string"),
+	[EK_MalformedExponent]   = str_literal("Malformed number exponent"),
+	[EK_UnexpectedCharacter] = str_literal("Unexpected character"),
+};
+
+bool error_list_init(ErrorList* list, Allocator allocator, Size cap){
+	mem_set(list, 0, sizeof(*list));
+	list->v = mem_new(Error, cap, allocator);
+	if(list->v == NULL){ return false; }
+	list->cap = cap;
+	list->allocator = allocator;
+	return true;
+}
+
+String error_message(U8 kind){
+	if(kind >= EK__Count){
+		return str_literal("Unknown error");
+	}
+	return ERROR_MESSAGES[kind];
+}
+
+SourceLocation error_list_locate(ErrorList* list, String source, Size i){
+	if(!list->lines_built){
+		if(!line_index_build(&list->lines, source, list->allocator)){
+			return (SourceLocation){0};
+		}
+		list->lines_built = true;
+	}
+	return line_index_locate(&list->lines, source, list->v[i].offset);
+}
+
+Lexer lexer_create(String source, ErrorList* errors){
+	return (Lexer){
+		.source = source,
+		.current = 0,
+		.previous = 0,
+		.errors = errors,
+	};
+}
+
+U8 lexer_advance(Lexer* lex){
+	if(lex->current >= lex->source.len){
+		return 0;
+	}
+	lex->current += 1;
+	return lex->source.v[lex->current - 1];
+}
+
+U8 lexer_peek(Lexer* lex){
+	if(lex->current >= lex->source.len){
+		return 0;
+	}
+	return lex->source.v[lex->current];
+}
+
+static inline
+bool is_number(U8 c){
+	return (c >= '0') && (c <= '9');
+}
+
+static inline
+bool is_whitespace(U8 c){
+	return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+
+static inline
+bool is_alpha(U8 c){
+	return ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || (c == '_');
+}
+
+static inline
+Token lexer_make_token(Lexer* lex, I32 kind){
+	return (Token){
+		.lexeme = str_sub(lex->source, lex->previous, lex->current - lex->previous),
+		.offset = lex->previous,
+		.kind = kind,
+	};
+}
+
+static
+Token lexer_string(Lexer* lex){
+	for(U8 c = lexer_advance(lex); c != '"'; c = lexer_advance(lex)){
+		if(c == 0 && lex->current >= lex->source.len){
+			lexer_push_error(lex, EK_UnterminatedString, lex->previous);
+			return lexer_make_token(lex, TK_Error);
+		}
+		if(c == '\\'){
+			lexer_advance(lex);
+		}
+	}
+	return lexer_make_token(lex, TK_String);
+}
+
+static
+Token lexer_number(Lexer* lex){
+	while(is_number(lexer_peek(lex))){ lexer_advance(lex); }
+
+	if(lexer_peek(lex) == '.'){
+		lexer_advance(lex);
+		while(is_number(lexer_peek(lex))){ lexer_advance(lex); }
+	}
+
+	U8 e = lexer_peek(lex);
+	if(e == 'e' || e == 'E'){
+		lexer_advance(lex);
+		U8 sign = lexer_peek(lex);
+		if(sign == '+' || sign == '-'){ lexer_advance(lex); }
+		if(!is_number(lexer_peek(lex))){
+			lexer_push_error(lex, EK_MalformedExponent, lex->previous);
+			return lexer_make_token(lex, TK_Error);
+		}
+		while(is_number(lexer_peek(lex))){ lexer_advance(lex); }
+	}
+
+	return lexer_make_token(lex, TK_Number);
+}
+
+static
+Token lexer_identifier(Lexer* lex){
+	for(U8 c = lexer_peek(lex); is_alpha(c) || is_number(c); c = lexer_peek(lex)){
+		lexer_advance(lex);
+	}
+
+	Token tk = lexer_make_token(lex, TK_Identifier);
+	if(str_eq(tk.lexeme, str_literal("nil"))){
+		tk.kind = TK_Nil;
+	}
+	else if(str_eq(tk.lexeme, str_literal("true"))){
+		tk.kind = TK_True;
+	}
+	else if(str_eq(tk.lexeme, str_literal("false"))){
+		tk.kind = TK_False;
+	}
+	return tk;
+}
+
+Token lexer_next(Lexer* lex){
+	trace_zone("lexer_next");
+	U8 c = 0;
+
+	// Skip whitespaces
+	for(c = lexer_advance(lex); is_whitespace(c); c = lexer_advance(lex)){
+	}
+	lex->previous = lex->current - 1;
+
+	switch(c){
+		case   0:
+			if(lex->current >= lex->source.len){
+				lex->previous = lex->current;
+				return lexer_make_token(lex, TK_EndOfFile);
+			}
+		break;
+		case '{': return lexer_make_token(lex, TK_CurlyOpen);
+		case '}': return lexer_make_token(lex, TK_CurlyClose);
+		case '[': return lexer_make_token(lex, TK_SquareOpen);
+		case ']': return lexer_make_token(lex, TK_SquareClose);
+		case ':': return lexer_make_token(lex, TK_Colon);
+		case ',': return lexer_make_token(lex, TK_Comma);
+		case '"': return lexer_string(lex);
+		case '-': {
+			if(is_number(lexer_peek(lex))){
+				return lexer_number(lex);
+			}
+		} break;
+		case '/': {
+			if(lexer_peek(lex) == '/'){
+				for(U8 n = lexer_peek(lex); n != '\n' && n != 0; n = lexer_peek(lex)){
+					lexer_advance(lex);
+				}
+				return lexer_make_token(lex, TK_Comment);
+			}
+		} break;
+	}
+
+	if(is_number(c)){
+		return lexer_number(lex);
+	}
+
+	if(is_alpha(c)){
+		return lexer_identifier(lex);
+	}
+
+	lexer_push_error(lex, EK_UnexpectedCharacter, lex->previous);
+	return lexer_make_token(lex, TK_Error);
+}
+
+void lexer_push_error(Lexer* lex, U8 kind, Size offset){
+	if(lex->errors != NULL){
+		error_list_push(lex->errors, kind, offset);
+	}
+}
+
+// Grow the 3 parallel arrays, offset and length share the same element size.
+// Either all of them are replaced or none is, so a failure leaves them consistent
+static
+bool token_soa_grow(Allocator al, U8** kind, void** offset, void** length, Size elem_size, Size old_cap, Size new_cap){
+	U8* new_kind = mem_alloc(al, new_cap, 1);
+	void* new_offset = mem_alloc(al, new_cap * elem_size, elem_size);
+	void* new_length = mem_alloc(al, new_cap * elem_size, elem_size);
+	if(new_kind == NULL || new_offset == NULL || new_length == NULL){
+		mem_free(al, new_kind, new_cap);
+		mem_free(al, new_offset, new_cap * elem_size);
+		mem_free(al, new_length, new_cap * elem_size);
+		return false;
+	}
+
+	if(old_cap > 0){
+		mem_copy_no_overlap(new_kind, *kind, old_cap);
+		mem_copy_no_overlap(new_offset, *offset, old_cap * elem_size);
+		mem_copy_no_overlap(new_length, *length, old_cap * elem_size);
+	}
+	mem_free(al, *kind, old_cap);
+	mem_free(al, *offset, old_cap * elem_size);
+	mem_free(al, *length, old_cap * elem_size);
+	*kind = new_kind;
+	*offset = new_offset;
+	*length = new_length;
+	return true;
+}
+
+// Add `delta` to the stored offsets of tokens [begin, end)
+static
+void token_array_shift(TokenArray* arr, Size begin, Size end, I64 delta){
+	for(Size i = begin; i < end; i += 1){
+		arr->offset[i] = (U32)((I64)arr->offset[i] + delta);
+	}
+}
+
+void token_array_flush(TokenArray* arr){
+	if(arr->shift_delta != 0){
+		token_array_shift(arr, arr->shift_start, arr->len, arr->shift_delta);
+	}
+	arr->shift_start = 0;
+	arr->shift_delta = 0;
+}
+
+bool token_array_push(TokenArray* arr, Token tk){
+	if(tk.offset > UINT32_MAX || tk.lexeme.len > UINT32_MAX){
+		return false;
+	}
+	if(hint_unlikely(arr->shift_delta != 0)){
+		token_array_flush(arr);
+	}
+	if(hint_unlikely(arr->len >= arr->cap)){
+		Size new_cap = max(TOKEN_ARRAY_MIN_CAP, arr->cap * 2);
+		if(!token_soa_grow(arr->allocator, &arr->kind, (void**)&arr->offset, (void**)&arr->length, sizeof(U32), arr->cap, new_cap)){
+			return false;
+		}
+		arr->cap = new_cap;
+	}
+	arr->kind[arr->len] = (U8)tk.kind;
+	arr->offset[arr->len] = (U32)tk.offset;
+	arr->length[arr->len] = (U32)tk.lexeme.len;
+	arr->len += 1;
+	return true;
+}
+
+Token token_array_get(TokenArray const* arr, String source, Size i){
+	Size offset = token_array_offset(arr, i);
+	return (Token){
+		.lexeme = str_sub(source, offset, arr->length[i]),
+		.offset = offset,
+		.kind = token_kind_decode(arr->kind[i]),
+	};
+}
+
+Size token_array_count_kind(TokenArray const* arr, I32 kind){
+	U8 k = (U8)kind;
+	Size count = 0;
+	for(Size i = 0; i < arr->len; i += 1){
+		count += arr->kind[i] == k;
+	}
+	return count;
+}
+
+bool token_array64_push(TokenArray64* arr, Token tk){
+	if(hint_unlikely(arr->len >= arr->cap)){
+		Size new_cap = max(TOKEN_ARRAY_MIN_CAP, arr->cap * 2);
+		if(!token_soa_grow(arr->allocator, &arr->kind, (void**)&arr->offset, (void**)&arr->length, sizeof(U64), arr->cap, new_cap)){
+			return false;
+		}
+		arr->cap = new_cap;
+	}
+	arr->kind[arr->len] = (U8)tk.kind;
+	arr->offset[arr->len] = tk.offset;
+	arr->length[arr->len] = (U64)tk.lexeme.len;
+	arr->len += 1;
+	return true;
+}
+
+Token token_array64_get(TokenArray64 const* arr, String source, Size i){
+	return (Token){
+		.lexeme = str_sub(source, arr->offset[i], arr->length[i]),
+		.offset = arr->offset[i],
+		.kind = token_kind_decode(arr->kind[i]),
+	};
+}
+
+bool lexer_tokenize(Lexer* lex, TokenArray* arr){
+	while(1){
+		Token tk = lexer_next(lex);
+		if(tk.kind == TK_EndOfFile){ break; }
+		if(!token_array_push(arr, tk)){
+			return false;
+		}
+	}
+	return true;
+}
+
+// Replace tokens [at, at + removed) with `src`
+static
+bool token_array_splice(TokenArray* arr, Size at, Size removed, TokenArray const* src){
+	Size new_len = arr->len - removed + src->len;
+	if(new_len > arr->cap){
+		Size new_cap = max(max(TOKEN_ARRAY_MIN_CAP, arr->cap * 2), new_len);
+		if(!token_soa_grow(arr->allocator, &arr->kind, (void**)&arr->offset, (void**)&arr->length, sizeof(U32), arr->cap, new_cap)){
+			return false;
+		}
+		arr->cap = new_cap;
+	}
+
+	Size tail = arr->len - (at + removed);
+	if(src->len != removed && tail > 0){
+		mem_copy(&arr->kind[at + src->len], &arr->kind[at + removed], tail);
+		mem_copy(&arr->offset[at + src->len], &arr->offset[at + removed], tail * sizeof(U32));
+		mem_copy(&arr->length[at + src->len], &arr->length[at + removed], tail * sizeof(U32));
+	}
+	mem_copy_no_overlap(&arr->kind[at], src->kind, src->len);
+	mem_copy_no_overlap(&arr->offset[at], src->offset, src->len * sizeof(U32));
+	mem_copy_no_overlap(&arr->length[at], src->length, src->len * sizeof(U32));
+	arr->len = new_len;
+	return true;
+}
+
+bool lexer_relex(TokenArray* arr, String source, TextEdit edit, Arena* scratch, ErrorList* errors){
+	if(source.len > UINT32_MAX){ return false; }
+	I64 delta = (I64)edit.inserted - (I64)edit.removed;
+	Size old_end = edit.offset + edit.removed;
+	Size new_end = edit.offset + edit.inserted;
+
+	// Lexing looks one byte past a token, so tokens ending right at the edit
+	// may change too. The first token that can't is the one before them.
+	Size first = 0;
+	for(Size lo = 0, hi = arr->len; lo < hi;){
+		Size mid = lo + (hi - lo) / 2;
+		if(token_array_offset(arr, mid) + arr->length[mid] < edit.offset){ lo = mid + 1; first = lo; }
+		else { hi = mid; }
+	}
+	Size restart = (first > 0) ? token_array_offset(arr, first - 1) + arr->length[first - 1] : 0;
+
+	// Keep the pending shift from covering the window, tokens before it are
+	// settled so the shift only has to be applied between the two edits
+	if(arr->shift_delta != 0 && arr->shift_start < first){
+		token_array_shift(arr, arr->shift_start, first, arr->shift_delta);
+		arr->shift_start = first;
+	}
+
+	ArenaTemp tmp = arena_temp_begin(scratch);
+	TokenArray window = { .allocator = arena_allocator(scratch) };
+
+	// Lex until a token starts where an old token past the edit would start
+	Lexer lex = lexer_create(source, errors);
+	lex.current = restart;
+	Size resync = first;
+	while(1){
+		Token tk = lexer_next(&lex);
+		if(tk.kind == TK_EndOfFile){
+			resync = arr->len;
+			break;
+		}
+		if((Size)tk.offset >= new_end){
+			while(resync < arr->len && (I64)token_array_offset(arr, resync) + delta < (I64)tk.offset){ resync += 1; }
+			if(resync < arr->len && (I64)token_array_offset(arr, resync) + delta == (I64)tk.offset && token_array_offset(arr, resync) >= old_end){
+				break;
+			}
+		}
+		if(!token_array_push(&window, tk)){
+			arena_temp_end(tmp);
+			return false;
+		}
+	}
+
+	I64 pending = arr->shift_delta;
+	Size pending_start = arr->shift_start;
+	bool ok = token_array_splice(arr, first, resync - first, &window);
+	arena_temp_end(tmp);
+	if(!ok){ return false; }
+
+	// Tokens after the window all need `delta`, the ones past the old shift
+	// start also still need the old shift
+	Size tail = first + window.len;
+	if(pending == 0 || pending_start <= resync){
+		arr->shift_start = tail;
+		arr->shift_delta = pending + delta;
+	}
+	else {
+		Size moved = pending_start - resync + tail;
+		token_array_shift(arr, tail, moved, delta);
+		arr->shift_start = moved;
+		arr->shift_delta = pending + delta;
+	}
+	return true;
+}
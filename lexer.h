@@ -0,0 +1,177 @@
+#ifndef _lexer_h_include_
+#define _lexer_h_include_
+
+#include "base/base.h"
+#include "base/strings.h"
+#include "base/allocator.h"
+
+typedef struct Lexer Lexer;
+typedef struct Token Token;
+typedef struct TokenArray TokenArray;
+typedef struct TokenArray64 TokenArray64;
+typedef struct Error Error;
+typedef struct ErrorList ErrorList;
+typedef struct TextEdit TextEdit;
+
+typedef enum {
+	EK_None = 0,
+	EK_UnterminatedString,
+	EK_MalformedExponent,
+	EK_UnexpectedCharacter,
+
+	EK__Count,
+} ErrorKind;
+
+struct Error {
+	Size offset;
+	U8   kind;
+};
+
+// Bounded error buffer, messages are static and errors past `cap` are only
+// counted, so malformed input can't make it grow.
+struct ErrorList {
+	Error* v;
+	Size   len;
+	Size   cap;
+	Size   dropped;
+	Allocator allocator;
+	LineIndex lines; // Built on first call to error_list_locate
+	bool   lines_built;
+};
+
+struct Lexer {
+	String source;
+	Size   current;
+	Size   previous;
+	ErrorList* errors;
+};
+
+typedef enum {
+	TK_Unknown = 0,
+
+	TK_Identifier, TK_String, TK_Number,
+	TK_Nil, TK_True, TK_False,
+
+	TK_CurlyOpen, TK_CurlyClose,
+	TK_SquareOpen, TK_SquareClose,
+
+	TK_Comma, TK_Colon,
+
+	TK_Comment,
+
+	TK_EndOfFile = -1,
+	TK_Error = -2,
+} TokenKind;
+
+struct Token {
+	String lexeme;
+	U64    offset;
+	I32    kind;
+};
+
+// Struct-of-arrays token storage, lexemes are rebuilt from the source on
+// demand. Kinds are stored as U8, negative kinds wrap around. After
+// lexer_relex the stored offsets of tokens past `shift_start` are off by
+// `shift_delta`, read them with token_array_offset.
+struct TokenArray {
+	U8*  kind;
+	U32* offset;
+	U32* length;
+	Size len;
+	Size cap;
+	Size shift_start;
+	I64  shift_delta;
+	Allocator allocator;
+};
+
+// Replacement of `removed` bytes at `offset` by `inserted` new bytes
+struct TextEdit {
+	Size offset;
+	Size removed;
+	Size inserted;
+};
+
+// Same as TokenArray, for sources bigger than 4 GiB
+struct TokenArray64 {
+	U8*  kind;
+	U64* offset;
+	U64* length;
+	Size len;
+	Size cap;
+	Allocator allocator;
+};
+
+#define TOKEN_ARRAY_MIN_CAP 64
+
+static inline
+I32 token_kind_decode(U8 kind){
+	return (I32)(I8)kind;
+}
+
+// Offset of token `i`, including any pending shift
+static inline
+Size token_array_offset(TokenArray const* arr, Size i){
+	I64 delta = (i >= arr->shift_start) ? arr->shift_delta : 0;
+	return (Size)((I64)arr->offset[i] + delta);
+}
+
+// Apply pending shift to the stored offsets
+void token_array_flush(TokenArray* arr);
+
+// Append token, returns false on allocation failure or if the token doesn't fit in 32 bits
+bool token_array_push(TokenArray* arr, Token tk);
+
+// Rebuild token `i`, `source` must be the source the tokens came from
+Token token_array_get(TokenArray const* arr, String source, Size i);
+
+// Count tokens of a given kind
+Size token_array_count_kind(TokenArray const* arr, I32 kind);
+
+// Append token, returns false on allocation failure
+bool token_array64_push(TokenArray64* arr, Token tk);
+
+// Rebuild token `i`, `source` must be the source the tokens came from
+Token token_array64_get(TokenArray64 const* arr, String source, Size i);
+
+// Lex the whole source into arr, stops at end of file. Returns false on allocation failure
+bool lexer_tokenize(Lexer* lex, TokenArray* arr);
+
+// Update `arr`, the tokens of the source before `edit`, to the tokens of
+// `source`, the text after it. Lexing restarts at the first token the edit
+// can change and stops as soon as it lines up with an old token past the
+// edit, the offsets of the tokens after that are shifted lazily. Window tokens
+// are staged in `scratch`, only errors inside the window are pushed to
+// `errors` (may be null). Returns false on allocation failure or if a token
+// doesn't fit in 32 bits, `arr` is left unchanged in that case
+bool lexer_relex(TokenArray* arr, String source, TextEdit edit, Arena* scratch, ErrorList* errors);
+
+// Initialize error list with room for `cap` errors
+bool error_list_init(ErrorList* list, Allocator allocator, Size cap);
+
+// Record an error, never allocates
+static inline
+void error_list_push(ErrorList* list, U8 kind, Size offset){
+	if(hint_unlikely(list->len >= list->cap)){
+		list->dropped += 1;
+		return;
+	}
+	list->v[list->len] = (Error){ .offset = offset, .kind = kind };
+	list->len += 1;
+}
+
+// Static description of an error kind
+String error_message(U8 kind);
+
+// Line and column of the i-th error, builds the line index of source on first use
+SourceLocation error_list_locate(ErrorList* list, String source, Size i);
+
+// Create a lexer over source, errors go to `errors` (may be null)
+Lexer lexer_create(String source, ErrorList* errors);
+
+// Get next token, strings keep their quotes in the lexeme
+Token lexer_next(Lexer* lex);
+
+// Record an error at `offset`
+void lexer_push_error(Lexer* lex, U8 kind, Size offset);
+
+#endif /* Include guard */
@@ -0,0 +1,373 @@
+#include "ondemand.h"
+#include "base/memory.h"
+#include <stdlib.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static inline
+bool json_is_whitespace(U8 c){
+	return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+
+// Skip whitespace and comments
+static
+Size json_skip_trivia(String s, Size i){
+	while(i < s.len){
+		U8 c = s.v[i];
+		if(json_is_whitespace(c)){
+			i += 1;
+		}
+		else if(c == '/' && i + 1 < s.len && s.v[i + 1] == '/'){
+			while(i < s.len && s.v[i] != '\n'){ i += 1; }
+		}
+		else {
+			break;
+		}
+	}
+	return i;
+}
+
+static inline
+Token json_token_at(String s, Size offset){
+	Lexer lex = lexer_create(s, NULL);
+	lex.current = offset;
+	return lexer_next(&lex);
+}
+
+// `i` points to the opening quote, returns offset past the closing one
+static
+Size json_skip_string(String s, Size i){
+	i += 1;
+	while(i < s.len){
+		#if defined(__SSE2__)
+		__m128i quote = _mm_set1_epi8('"');
+		__m128i escape = _mm_set1_epi8('\\');
+		while(i + 16 <= s.len){
+			__m128i chunk = _mm_loadu_si128((__m128i const*)&s.v[i]);
+			U32 mask = (U32)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, escape)));
+			if(mask != 0){
+				i += __builtin_ctz(mask);
+				break;
+			}
+			i += 16;
+		}
+		if(i >= s.len){ break; }
+		#endif
+		U8 c = s.v[i];
+		if(c == '"'){
+			return i + 1;
+		}
+		i += (c == '\\') ? 2 : 1;
+	}
+	return s.len; /* Unterminated */
+}
+
+// `i` points to '{' or '[', returns offset past the matching closer
+static
+Size json_skip_container(String s, Size i){
+	Size depth = 0;
+	while(i < s.len){
+		#if defined(__SSE2__)
+		// Jump over blocks without any byte that can change the depth
+		if(depth > 0){
+			while(i + 16 <= s.len){
+				__m128i chunk = _mm_loadu_si128((__m128i const*)&s.v[i]);
+				__m128i hits = _mm_or_si128(
+					_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('"')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('/'))),
+					_mm_or_si128(
+						_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('{')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8('}'))),
+						_mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('[')), _mm_cmpeq_epi8(chunk, _mm_set1_epi8(']')))));
+				U32 mask = (U32)_mm_movemask_epi8(hits);
+				if(mask != 0){
+					i += __builtin_ctz(mask);
+					break;
+				}
+				i += 16;
+			}
+			if(i >= s.len){ break; }
+		}
+		#endif
+
+		U8 c = s.v[i];
+		switch(c){
+			case '{': case '[':
+				depth += 1;
+			break;
+			case '}': case ']':
+				depth -= 1;
+				if(depth == 0){ return i + 1; }
+			break;
+			case '"':
+				i = json_skip_string(s, i);
+			continue;
+			case '/':
+				if(i + 1 < s.len && s.v[i + 1] == '/'){
+					while(i < s.len && s.v[i] != '\n'){ i += 1; }
+					continue;
+				}
+			break;
+		}
+		i += 1;
+	}
+	return s.len; /* Unterminated */
+}
+
+Size json_skip_value(String s, Size offset){
+	offset = json_skip_trivia(s, offset);
+	if(offset >= s.len){
+		return s.len;
+	}
+	U8 c = s.v[offset];
+	if(c == '{' || c == '['){
+		return json_skip_container(s, offset);
+	}
+	if(c == '"'){
+		return json_skip_string(s, offset);
+	}
+	Token tk = json_token_at(s, offset);
+	return tk.offset + tk.lexeme.len;
+}
+
+JsonValue json_root(String source){
+	return (JsonValue){
+		.source = source,
+		.offset = json_skip_trivia(source, 0),
+	};
+}
+
+I32 json_kind(JsonValue v){
+	if(v.offset >= v.source.len){
+		return TK_EndOfFile;
+	}
+	switch(v.source.v[v.offset]){
+		case '{': return TK_CurlyOpen;
+		case '[': return TK_SquareOpen;
+		case '"': return TK_String;
+	}
+	return json_token_at(v.source, v.offset).kind;
+}
+
+static
+JsonIterator json_iter(JsonValue v, U8 open){
+	JsonIterator it = { .source = v.source, .offset = v.offset };
+	if(v.offset >= v.source.len || v.source.v[v.offset] != open){
+		it.done = true;
+		it.failed = true;
+		return it;
+	}
+	it.offset = v.offset + 1;
+	return it;
+}
+
+// Move past the previous value and its separator, returns false when the container ends
+static
+bool json_iter_advance(JsonIterator* it, U8 close){
+	if(it->done){ return false; }
+	String s = it->source;
+
+	if(it->pending_value){
+		Size i = json_skip_trivia(s, json_skip_value(s, it->offset));
+		it->pending_value = false;
+		if(i < s.len && s.v[i] == ','){
+			it->offset = i + 1;
+		}
+		else if(i < s.len && s.v[i] == close){
+			it->done = true;
+			return false;
+		}
+		else {
+			it->done = it->failed = true;
+			return false;
+		}
+	}
+
+	Size i = json_skip_trivia(s, it->offset);
+	if(i >= s.len){
+		it->done = it->failed = true;
+		return false;
+	}
+	if(s.v[i] == close){
+		it->done = true;
+		return false;
+	}
+	it->offset = i;
+	return true;
+}
+
+JsonIterator json_array_iter(JsonValue arr){
+	return json_iter(arr, '[');
+}
+
+bool json_array_next(JsonIterator* it, JsonValue* out){
+	if(!json_iter_advance(it, ']')){
+		return false;
+	}
+	*out = (JsonValue){ .source = it->source, .offset = it->offset };
+	it->pending_value = true;
+	return true;
+}
+
+JsonIterator json_object_iter(JsonValue obj){
+	return json_iter(obj, '{');
+}
+
+bool json_object_next(JsonIterator* it, String* key, JsonValue* out){
+	if(!json_iter_advance(it, '}')){
+		return false;
+	}
+	String s = it->source;
+
+	if(s.v[it->offset] != '"'){
+		it->done = it->failed = true;
+		return false;
+	}
+	Size key_end = json_skip_string(s, it->offset);
+	Size colon = json_skip_trivia(s, key_end);
+	if(colon >= s.len || s.v[colon] != ':'){
+		it->done = it->failed = true;
+		return false;
+	}
+
+	*key = str_sub(s, it->offset + 1, max(key_end - it->offset - 2, 0));
+	it->offset = json_skip_trivia(s, colon + 1);
+	*out = (JsonValue){ .source = s, .offset = it->offset };
+	it->pending_value = true;
+	return true;
+}
+
+bool json_find_field(JsonValue obj, String key, JsonValue* out){
+	JsonIterator it = json_object_iter(obj);
+	String k;
+	JsonValue v;
+	while(json_object_next(&it, &k, &v)){
+		if(str_eq(k, key)){
+			*out = v;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool json_get_i64(JsonValue v, I64* out){
+	Token tk = json_token_at(v.source, v.offset);
+	if(tk.kind != TK_Number){ return false; }
+
+	String s = tk.lexeme;
+	bool negative = s.v[0] == '-';
+	U64 n = 0;
+	for(Size i = negative ? 1 : 0; i < s.len; i += 1){
+		U8 c = s.v[i];
+		if(c < '0' || c > '9'){ return false; } /* Not an integer */
+		U64 next = n * 10 + (c - '0');
+		if(next / 10 != n){ return false; } /* Overflow */
+		n = next;
+	}
+	if(n > (U64)INT64_MAX + (negative ? 1 : 0)){
+		return false;
+	}
+	*out = negative ? (I64)(0 - n) : (I64)n;
+	return true;
+}
+
+// Significant digits kept from long literals. Past them a single sticky digit
+// stands in for the rest, which is enough to round any double correctly
+#define JSON_F64_MAX_DIGITS 768
+
+// Exponents are clamped to this, far past where doubles overflow or go to zero
+#define JSON_F64_MAX_EXPONENT 100000
+
+// Rewrite a number lexeme of any length as ".<digits>e<exponent>" in `buf`,
+// which must hold JSON_F64_MAX_DIGITS + 32 bytes
+static
+void json_normalize_number(String s, char* buf){
+	Size n = 0, i = 0;
+	if(i < s.len && s.v[i] == '-'){ buf[n++] = '-'; i += 1; }
+	buf[n++] = '.';
+
+	I64 exponent = 0;
+	Size digits = 0;
+	bool fraction = false, sticky = false;
+	for(; i < s.len; i += 1){
+		U8 c = s.v[i];
+		if(c == '.'){ fraction = true; continue; }
+		if(c < '0' || c > '9'){ break; }
+		if(digits == 0 && c == '0'){
+			exponent -= fraction ? 1 : 0; /* Leading zeros */
+			continue;
+		}
+		exponent += fraction ? 0 : 1;
+		if(digits < JSON_F64_MAX_DIGITS){ buf[n++] = (char)c; }
+		else { sticky = sticky || c != '0'; }
+		digits += 1;
+	}
+	if(digits == 0){ buf[n++] = '0'; }
+	if(sticky){ buf[n++] = '1'; }
+
+	if(i < s.len && (s.v[i] == 'e' || s.v[i] == 'E')){
+		i += 1;
+		bool negative = i < s.len && s.v[i] == '-';
+		if(i < s.len && (s.v[i] == '-' || s.v[i] == '+')){ i += 1; }
+		I64 e = 0;
+		for(; i < s.len && s.v[i] >= '0' && s.v[i] <= '9'; i += 1){
+			e = min(e * 10 + (s.v[i] - '0'), (I64)JSON_F64_MAX_EXPONENT);
+		}
+		exponent += negative ? -e : e;
+	}
+	exponent = clamp(-JSON_F64_MAX_EXPONENT, exponent, JSON_F64_MAX_EXPONENT);
+
+	buf[n++] = 'e';
+	if(exponent < 0){ buf[n++] = '-'; exponent = -exponent; }
+	char rev[8];
+	Size len = 0;
+	do {
+		rev[len++] = (char)('0' + exponent % 10);
+		exponent /= 10;
+	} while(exponent > 0);
+	while(len > 0){ buf[n++] = rev[--len]; }
+	buf[n] = 0;
+}
+
+bool json_get_f64(JsonValue v, F64* out){
+	Token tk = json_token_at(v.source, v.offset);
+	if(tk.kind != TK_Number){ return false; }
+
+	if(hint_likely(tk.lexeme.len < 64)){
+		char buf[64];
+		mem_copy_no_overlap(buf, tk.lexeme.v, tk.lexeme.len);
+		buf[tk.lexeme.len] = 0;
+		*out = strtod(buf, NULL);
+		return true;
+	}
+
+	char buf[JSON_F64_MAX_DIGITS + 32];
+	json_normalize_number(tk.lexeme, buf);
+	*out = strtod(buf, NULL);
+	return true;
+}
+
+bool json_get_bool(JsonValue v, bool* out){
+	I32 kind = json_kind(v);
+	if(kind != TK_True && kind != TK_False){ return false; }
+	*out = kind == TK_True;
+	return true;
+}
+
+bool json_get_string(JsonValue v, String* out){
+	if(v.offset >= v.source.len || v.source.v[v.offset] != '"'){ return false; }
+	Size end = json_skip_string(v.source, v.offset);
+	if(end > v.source.len || v.source.v[end - 1] != '"' || end - v.offset < 2){ return false; }
+	if(end == v.source.len){
+		// Unterminated strings also end there, the last quote must not be escaped
+		Size slashes = 0;
+		while(end - 2 - slashes > v.offset && v.source.v[end - 2 - slashes] == '\\'){ slashes += 1; }
+		if(slashes % 2 != 0){ return false; }
+	}
+	*out = str_sub(v.source, v.offset + 1, end - v.offset - 2);
+	return true;
+}
+
+bool json_is_nil(JsonValue v){
+	return json_kind(v) == TK_Nil;
+}
@@ -0,0 +1,65 @@
+#ifndef _ondemand_h_include_
+#define _ondemand_h_include_
+
+#include "base/base.h"
+#include "base/strings.h"
+#include "lexer.h"
+
+// On-demand access to a document: values are only lexed and decoded when they
+// are touched, subtrees that aren't visited are skipped with a bracket-depth
+// scan that never produces tokens.
+
+typedef struct JsonValue JsonValue;
+typedef struct JsonIterator JsonIterator;
+
+// Position of a value inside the source
+struct JsonValue {
+	String source;
+	Size   offset;
+};
+
+// Iterator over the elements of an array or the fields of an object
+struct JsonIterator {
+	String source;
+	Size   offset; // Next element, or where the previous value started
+	bool   pending_value;
+	bool   done;
+	bool   failed;
+};
+
+// Root value of a document
+JsonValue json_root(String source);
+
+// Kind of the value's first token (TK_CurlyOpen, TK_String, TK_Number, ...)
+I32 json_kind(JsonValue v);
+
+// Find field `key` of an object, keys are compared without decoding escapes
+bool json_find_field(JsonValue obj, String key, JsonValue* out);
+
+// Get an iterator over array elements
+JsonIterator json_array_iter(JsonValue arr);
+
+// Get next array element, returns false at the end or on malformed input
+bool json_array_next(JsonIterator* it, JsonValue* out);
+
+// Get an iterator over object fields
+JsonIterator json_object_iter(JsonValue obj);
+
+// Get next field, key is given without quotes. Returns false at the end or on malformed input
+bool json_object_next(JsonIterator* it, String* key, JsonValue* out);
+
+// Offset one past the end of the value starting at `offset`
+Size json_skip_value(String source, Size offset);
+
+bool json_get_i64(JsonValue v, I64* out);
+
+bool json_get_f64(JsonValue v, F64* out);
+
+bool json_get_bool(JsonValue v, bool* out);
+
+// Get string contents without quotes, escapes are not decoded
+bool json_get_string(JsonValue v, String* out);
+
+bool json_is_nil(JsonValue v);
+
+#endif /* Include guard */
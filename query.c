@@ -0,0 +1,243 @@
+#include "query.h"
+#include "base/memory.h"
+#include "base/allocator.h"
+
+// Parse an array index, digits only and no leading zeros. Returns -1 if `s` isn't one
+static
+Size query_parse_index(String s){
+	if(s.len == 0 || s.len > 18 || (s.len > 1 && s.v[0] == '0')){
+		return -1;
+	}
+	Size n = 0;
+	for(Size i = 0; i < s.len; i += 1){
+		if(s.v[i] < '0' || s.v[i] > '9'){ return -1; }
+		n = n * 10 + (s.v[i] - '0');
+	}
+	return n;
+}
+
+// Copy pointer segment into the arena, decoding "~0" and "~1"
+static
+bool query_pointer_key(Arena* arena, String seg, String* out){
+	U8* buf = arena_push(arena, U8, max(seg.len, 1));
+	if(buf == NULL){ return false; }
+
+	Size len = 0;
+	for(Size i = 0; i < seg.len; i += 1){
+		U8 c = seg.v[i];
+		if(c == '~'){
+			if(i + 1 >= seg.len){ return false; }
+			U8 e = seg.v[i + 1];
+			if(e == '0')      { c = '~'; }
+			else if(e == '1') { c = '/'; }
+			else              { return false; }
+			i += 1;
+		}
+		buf[len] = c;
+		len += 1;
+	}
+	*out = str_from_bytes(buf, len);
+	return true;
+}
+
+static
+bool query_compile_pointer(JsonQuery* q, Arena* arena, String path){
+	Size cap = 0;
+	for(Size i = 0; i < path.len; i += 1){
+		cap += path.v[i] == '/';
+	}
+	q->steps = arena_push(arena, JsonQueryStep, max(cap, 1));
+	if(q->steps == NULL){ return false; }
+
+	Size i = 0;
+	while(i < path.len){
+		// path.v[i] is always '/' here
+		Size start = i + 1;
+		Size end = start;
+		while(end < path.len && path.v[end] != '/'){ end += 1; }
+
+		JsonQueryStep step = { .kind = QS_Key };
+		if(!query_pointer_key(arena, str_sub(path, start, end - start), &step.key)){
+			return false;
+		}
+		step.index = query_parse_index(step.key);
+		q->steps[q->len] = step;
+		q->len += 1;
+		i = end;
+	}
+	return true;
+}
+
+static
+bool query_compile_dollar(JsonQuery* q, Arena* arena, String path){
+	Size cap = 0;
+	for(Size i = 0; i < path.len; i += 1){
+		cap += path.v[i] == '.' || path.v[i] == '[';
+	}
+	q->steps = arena_push(arena, JsonQueryStep, max(cap, 1));
+	if(q->steps == NULL){ return false; }
+
+	Size i = 1;
+	while(i < path.len){
+		JsonQueryStep step = { .index = -1 };
+		U8 c = path.v[i];
+
+		if(c == '.'){
+			Size start = i + 1;
+			Size end = start;
+			while(end < path.len && path.v[end] != '.' && path.v[end] != '['){ end += 1; }
+			String name = str_sub(path, start, end - start);
+			if(name.len == 0){ return false; }
+
+			if(str_eq(name, str_literal("*"))){
+				step.kind = QS_Wildcard;
+			}
+			else {
+				step.kind = QS_Key;
+				step.key = str_clone(name, arena_allocator(arena));
+				if(step.key.v == NULL){ return false; }
+			}
+			i = end;
+		}
+		else if(c == '['){
+			Size start = i + 1;
+			Size end = start;
+			if(start < path.len && (path.v[start] == '\'' || path.v[start] == '"')){
+				U8 quote = path.v[start];
+				end = start + 1;
+				while(end < path.len && path.v[end] != quote){ end += 1; }
+				if(end + 1 >= path.len || path.v[end + 1] != ']'){ return false; }
+				step.kind = QS_Key;
+				step.key = str_clone(str_sub(path, start + 1, end - start - 1), arena_allocator(arena));
+				if(step.key.v == NULL){ return false; }
+				end += 1;
+			}
+			else {
+				while(end < path.len && path.v[end] != ']'){ end += 1; }
+				if(end >= path.len){ return false; }
+				String inner = str_sub(path, start, end - start);
+				if(str_eq(inner, str_literal("*"))){
+					step.kind = QS_Wildcard;
+				}
+				else {
+					step.kind = QS_Index;
+					step.index = query_parse_index(inner);
+					if(step.index < 0){ return false; }
+				}
+			}
+			i = end + 1;
+		}
+		else {
+			return false;
+		}
+
+		q->steps[q->len] = step;
+		q->len += 1;
+	}
+	return true;
+}
+
+bool json_query_compile(JsonQuery* q, Arena* arena, String path){
+	*q = (JsonQuery){0};
+	if(path.len == 0){
+		return true; /* Whole document */
+	}
+	if(path.v[0] == '/'){
+		return query_compile_pointer(q, arena, path);
+	}
+	if(path.v[0] == '$'){
+		return query_compile_dollar(q, arena, path);
+	}
+	return false;
+}
+
+static
+bool query_array_at(JsonValue arr, Size index, JsonValue* out){
+	JsonIterator it = json_array_iter(arr);
+	JsonValue v;
+	for(Size i = 0; json_array_next(&it, &v); i += 1){
+		if(i == index){
+			*out = v;
+			return true;
+		}
+	}
+	return false;
+}
+
+typedef struct {
+	JsonQuery const* query;
+	JsonQueryFunc func;
+	void* data;
+	Size matches;
+} QueryRun;
+
+// Match steps [step, len) starting at `v`, returns false once the callback asks to stop
+static
+bool query_exec(QueryRun* run, Size step, JsonValue v){
+	if(step == run->query->len){
+		run->matches += 1;
+		return run->func(run->data, v);
+	}
+
+	JsonQueryStep const* s = &run->query->steps[step];
+	I32 kind = json_kind(v);
+	JsonValue next;
+
+	switch(s->kind){
+		case QS_Key:
+			if(kind == TK_CurlyOpen){
+				if(json_find_field(v, s->key, &next)){
+					return query_exec(run, step + 1, next);
+				}
+			}
+			else if(kind == TK_SquareOpen && s->index >= 0){
+				if(query_array_at(v, s->index, &next)){
+					return query_exec(run, step + 1, next);
+				}
+			}
+		break;
+
+		case QS_Index:
+			if(kind == TK_SquareOpen && query_array_at(v, s->index, &next)){
+				return query_exec(run, step + 1, next);
+			}
+		break;
+
+		case QS_Wildcard:
+			if(kind == TK_SquareOpen){
+				JsonIterator it = json_array_iter(v);
+				while(json_array_next(&it, &next)){
+					if(!query_exec(run, step + 1, next)){ return false; }
+				}
+			}
+			else if(kind == TK_CurlyOpen){
+				JsonIterator it = json_object_iter(v);
+				String key;
+				while(json_object_next(&it, &key, &next)){
+					if(!query_exec(run, step + 1, next)){ return false; }
+				}
+			}
+		break;
+	}
+	return true;
+}
+
+Size json_query_run(JsonQuery const* q, JsonValue root, JsonQueryFunc func, void* data){
+	QueryRun run = {
+		.query = q,
+		.func = func,
+		.data = data,
+	};
+	query_exec(&run, 0, root);
+	return run.matches;
+}
+
+static
+bool query_first_func(void* data, JsonValue value){
+	*(JsonValue*)data = value;
+	return false;
+}
+
+bool json_query_first(JsonQuery const* q, JsonValue root, JsonValue* out){
+	return json_query_run(q, root, query_first_func, out) > 0;
+}
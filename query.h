@@ -0,0 +1,50 @@
+#ifndef _query_h_include_
+#define _query_h_include_
+
+#include "base/base.h"
+#include "base/strings.h"
+#include "base/arena.h"
+#include "ondemand.h"
+
+// Path queries compiled once into a flat list of steps, then run against any
+// number of documents with the on-demand cursor. Matches are handed to a
+// callback as they are found, nothing is collected.
+//
+// Supported syntax:
+//   JSON Pointer: "", "/a/b/0", "/a~1b" ("~1" is '/', "~0" is '~')
+//   Path subset:  "$", "$.a.b", "$.a[0]", "$.a[*].b", "$.*", "$['a b']"
+
+typedef struct JsonQuery JsonQuery;
+typedef struct JsonQueryStep JsonQueryStep;
+
+typedef enum {
+	QS_Key = 0,  // Object field, pointer segments made of digits also index arrays
+	QS_Index,    // Array element
+	QS_Wildcard, // Every array element or object field
+} JsonQueryStepKind;
+
+struct JsonQueryStep {
+	String key;   // Owned by the query's arena
+	Size   index; // -1 if the step can't index an array
+	U8     kind;
+};
+
+struct JsonQuery {
+	JsonQueryStep* steps;
+	Size len;
+};
+
+// Called for every match, return false to stop the query
+typedef bool (*JsonQueryFunc)(void* data, JsonValue value);
+
+// Compile `path` into `q`, steps and keys are allocated from `arena` so the
+// path string doesn't have to outlive the query. Returns false on malformed paths
+bool json_query_compile(JsonQuery* q, Arena* arena, String path);
+
+// Run the query over the document at `root`, returns the number of matches
+Size json_query_run(JsonQuery const* q, JsonValue root, JsonQueryFunc func, void* data);
+
+// Get the first match, returns false if there's none
+bool json_query_first(JsonQuery const* q, JsonValue root, JsonValue* out);
+
+#endif /* Include guard */
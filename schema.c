@@ -0,0 +1,103 @@
+#include "schema.h"
+#include "base/memory.h"
+#include "base/thread.h"
+#include "base/hash.h"
+
+// Seeds tried per table size before the table is doubled
+#define SCHEMA_MAX_SEED_TRIES 4096
+
+// Tables are built at runtime, so the process local hash is fine
+static inline
+U32 schema_hash(String key, U32 seed){
+	return (U32)hash_str_local(key, seed);
+}
+
+// Find a seed that sends every key to its own slot
+static
+void schema_build(Schema* schema){
+	ensure(schema->count <= SCHEMA_MAX_SLOTS / 2, "Too many fields in schema");
+	Size size = 4;
+	while(size < schema->count * 2){ size *= 2; }
+
+	for(; size <= SCHEMA_MAX_SLOTS; size *= 2){
+		U32 mask = (U32)size - 1;
+		for(U32 seed = 1; seed <= SCHEMA_MAX_SEED_TRIES; seed += 1){
+			mem_set(schema->slots, 0, sizeof(schema->slots));
+			bool ok = true;
+			for(Size i = 0; i < schema->count && ok; i += 1){
+				U32 slot = schema_hash(schema->fields[i].key, seed) & mask;
+				ok = schema->slots[slot] == 0;
+				schema->slots[slot] = (U8)(i + 1);
+			}
+			if(ok){
+				schema->seed = seed;
+				schema->mask = mask;
+				return;
+			}
+		}
+	}
+	panic("Could not build perfect hash for schema");
+}
+
+static
+void schema_ensure_built(Schema* schema){
+	if(hint_likely(atomic_load_explicit(&schema->state, memory_order_acquire) == 2)){
+		return;
+	}
+	U32 expected = 0;
+	if(atomic_compare_exchange_strong_explicit(&schema->state, &expected, 1, memory_order_acquire, memory_order_relaxed)){
+		schema_build(schema);
+		atomic_store_explicit(&schema->state, 2, memory_order_release);
+		return;
+	}
+	while(atomic_load_explicit(&schema->state, memory_order_acquire) != 2){
+		cpu_relax();
+	}
+}
+
+bool schema_decode(Schema* schema, JsonValue obj, void* out){
+	schema_ensure_built(schema);
+
+	JsonIterator it = json_object_iter(obj);
+	String key;
+	JsonValue v;
+	while(json_object_next(&it, &key, &v)){
+		U8 slot = schema->slots[schema_hash(key, schema->seed) & schema->mask];
+		if(slot == 0){ continue; }
+
+		SchemaField const* field = &schema->fields[slot - 1];
+		if(!str_eq(field->key, key)){ continue; }
+		if(!field->decode(v, (U8*)out + field->offset)){ return false; }
+	}
+	return !it.failed;
+}
+
+bool schema_decode_I64(JsonValue v, void* out){
+	return json_get_i64(v, out);
+}
+
+bool schema_decode_I32(JsonValue v, void* out){
+	I64 n = 0;
+	if(!json_get_i64(v, &n) || n < INT32_MIN || n > INT32_MAX){ return false; }
+	*(I32*)out = (I32)n;
+	return true;
+}
+
+bool schema_decode_F64(JsonValue v, void* out){
+	return json_get_f64(v, out);
+}
+
+bool schema_decode_F32(JsonValue v, void* out){
+	F64 n = 0;
+	if(!json_get_f64(v, &n)){ return false; }
+	*(F32*)out = (F32)n;
+	return true;
+}
+
+bool schema_decode_bool(JsonValue v, void* out){
+	return json_get_bool(v, out);
+}
+
+bool schema_decode_String(JsonValue v, void* out){
+	return json_get_string(v, out);
+}
@@ -0,0 +1,80 @@
+#ifndef _schema_h_include_
+#define _schema_h_include_
+// Fixed schema decoders for C
+// Fields are declared once with an X-macro taking (Type, Name):
+//
+//     #define POINT_FIELDS(X) X(I64, id) X(F64, score) X(String, name)
+//
+//     SCHEMA_DECLARE(Point, POINT_FIELDS)  // In a header: struct Point + Point_decode
+//     SCHEMA_DEFINE(Point, POINT_FIELDS)   // In one source file
+//
+// Point_decode(JsonValue obj, Point* out) walks the object once with the
+// on-demand cursor, maps each key to its field through a perfect hash and
+// parses the value straight into the struct. Unknown keys are skipped, fields
+// missing from the document are left untouched, a value of the wrong type
+// makes the decode fail. String fields point into the source.
+//
+// Supported types: I64, I32, F64, F32, bool, String.
+
+#include "base/base.h"
+#include "base/strings.h"
+#include "ondemand.h"
+
+// Max slots of a perfect hash table, schemas can have up to half as many fields
+#define SCHEMA_MAX_SLOTS 256
+
+typedef struct Schema Schema;
+typedef struct SchemaField SchemaField;
+
+typedef bool (*SchemaDecodeFunc)(JsonValue v, void* out);
+
+struct SchemaField {
+	String key;
+	Size   offset;
+	SchemaDecodeFunc decode;
+};
+
+// Field table plus its perfect hash, which is seeded on first use
+struct Schema {
+	SchemaField const* fields;
+	Size count;
+	AtomicU32 state; // 0: not built, 1: being built, 2: ready
+	U32 seed;
+	U32 mask;
+	U8  slots[SCHEMA_MAX_SLOTS]; // Field index + 1, 0 is empty
+};
+
+bool schema_decode_I64(JsonValue v, void* out);
+bool schema_decode_I32(JsonValue v, void* out);
+bool schema_decode_F64(JsonValue v, void* out);
+bool schema_decode_F32(JsonValue v, void* out);
+bool schema_decode_bool(JsonValue v, void* out);
+bool schema_decode_String(JsonValue v, void* out);
+
+// Decode object `obj` into `out` using the schema's field table
+bool schema_decode(Schema* schema, JsonValue obj, void* out);
+
+#define SCHEMA_STRUCT_FIELD(Type, Name) Type Name;
+
+#define SCHEMA_TABLE_FIELD(Type, Name) \
+	{ .key = { .v = (U8 const*)#Name, .len = sizeof(#Name) - 1 }, .offset = offsetof(SchemaSelf_, Name), .decode = schema_decode_##Type },
+
+#define SCHEMA_DECLARE(Name, Fields)                \
+	typedef struct Name Name;                       \
+	struct Name {                                   \
+		Fields(SCHEMA_STRUCT_FIELD)                 \
+	};                                              \
+	bool Name##_decode(JsonValue obj, Name* out);
+
+#define SCHEMA_DEFINE(Name, Fields)                                          \
+	bool Name##_decode(JsonValue obj, Name* out){                            \
+		typedef Name SchemaSelf_;                                            \
+		static SchemaField const fields[] = { Fields(SCHEMA_TABLE_FIELD) };  \
+		static Schema schema = {                                             \
+			.fields = fields,                                                \
+			.count = sizeof(fields) / sizeof(fields[0]),                     \
+		};                                                                   \
+		return schema_decode(&schema, obj, out);                             \
+	}
+
+#endif /* Include guard */
@@ -0,0 +1,370 @@
+#include "tape.h"
+#include "base/memory.h"
+#include "base/hash.h"
+#include "base/dynamic_array.h"
+#include "lexer.h"
+#include "ondemand.h"
+
+#define TAPE_MIN_SLOTS 64
+
+static_assert(sizeof(TapeHeader) % 8 == 0 && sizeof(TapeNode) == 24 && sizeof(TapeKey) == 16, "Tape layout changed");
+
+// Stored in images, so it has to be the stable hash
+static inline
+U32 tape_hash(String s){
+	return (U32)hash_str(s, 0);
+}
+
+static inline
+Size tape_align8(Size n){
+	return (n + 7) & ~(Size)7;
+}
+
+void tape_builder_init(TapeBuilder* b, Allocator allocator){
+	*b = (TapeBuilder){0};
+	b->nodes.allocator = allocator;
+	b->keys.allocator = allocator;
+	b->slots.allocator = allocator;
+	b->strings.allocator = allocator;
+	b->stack.allocator = allocator;
+}
+
+void tape_builder_destroy(TapeBuilder* b){
+	mem_free(b->nodes.allocator, b->nodes.v, b->nodes.cap * sizeof(TapeNode));
+	mem_free(b->keys.allocator, b->keys.v, b->keys.cap * sizeof(TapeKey));
+	mem_free(b->slots.allocator, b->slots.v, b->slots.cap * sizeof(U32));
+	mem_free(b->strings.allocator, b->strings.v, b->strings.cap);
+	mem_free(b->stack.allocator, b->stack.v, b->stack.cap * sizeof(Size));
+	tape_builder_init(b, b->nodes.allocator);
+}
+
+// Grow array to hold at least `min_cap` elements, returns false on allocation failure
+static
+bool tape_grow(void** v, Size* cap, Allocator allocator, Size min_cap, Size elem_size, Size align){
+	Size new_cap = max(max(*cap * 2, min_cap), DYN_ARRAY_MIN_CAP);
+	void* data = mem_realloc(allocator, *v, *cap * elem_size, new_cap * elem_size, align);
+	if(data == NULL){ return false; }
+	*v = data;
+	*cap = new_cap;
+	return true;
+}
+
+// Make room for `N` more elements in one of the builder's arrays
+#define tape_reserve(ArrPtr, N) \
+	(((ArrPtr)->len + (N) <= (ArrPtr)->cap) || tape_grow((void**)&(ArrPtr)->v, &(ArrPtr)->cap, (ArrPtr)->allocator, \
+		(ArrPtr)->len + (N), sizeof(*(ArrPtr)->v), alignof(typeof(*(ArrPtr)->v))))
+
+static
+bool tape_push_bytes(TapeBuilder* b, String s, U64* offset){
+	if(!tape_reserve(&b->strings, s.len)){ return false; }
+	mem_copy_no_overlap(&b->strings.v[b->strings.len], s.v, s.len);
+	*offset = b->strings.len;
+	b->strings.len += s.len;
+	return true;
+}
+
+// Grow slot table to `cap` and reinsert every key
+static
+bool tape_rehash(TapeBuilder* b, Size cap){
+	U32* slots = mem_alloc(b->slots.allocator, cap * sizeof(U32), alignof(U32));
+	if(slots == NULL){ return false; }
+	mem_set(slots, 0, cap * sizeof(U32));
+
+	for(Size id = 0; id < b->keys.len; id += 1){
+		Size i = b->keys.v[id].hash & (cap - 1);
+		while(slots[i] != 0){ i = (i + 1) & (cap - 1); }
+		slots[i] = (U32)id + 1;
+	}
+	mem_free(b->slots.allocator, b->slots.v, b->slots.cap * sizeof(U32));
+	b->slots.v = slots;
+	b->slots.cap = b->slots.len = cap;
+	return true;
+}
+
+static
+U32 tape_intern(TapeBuilder* b, String key){
+	U32 hash = tape_hash(key);
+	Size mask = b->slots.len - 1;
+	Size i = hash & mask;
+	for(U32 slot; (slot = b->slots.v[i]) != 0; i = (i + 1) & mask){
+		TapeKey const* k = &b->keys.v[slot - 1];
+		if(k->hash == hash && str_eq(str_from_bytes(&b->strings.v[k->offset], k->len), key)){
+			return slot - 1;
+		}
+	}
+
+	// Keep load under 1/2
+	if((b->keys.len + 1) * 2 > b->slots.len){
+		if(!tape_rehash(b, b->slots.len * 2)){ return TAPE_NO_KEY; }
+		return tape_intern(b, key);
+	}
+
+	TapeKey k = { .len = (U32)key.len, .hash = hash };
+	if(key.len > UINT32_MAX || !tape_reserve(&b->keys, 1) || !tape_push_bytes(b, key, &k.offset)){
+		return TAPE_NO_KEY;
+	}
+	dyn_array_push(&b->keys, k);
+
+	b->slots.v[i] = (U32)b->keys.len;
+	return (U32)(b->keys.len - 1);
+}
+
+static inline
+Token tape_next_token(Lexer* lex){
+	Token tk = lexer_next(lex);
+	while(tk.kind == TK_Comment){
+		tk = lexer_next(lex);
+	}
+	return tk;
+}
+
+// Append node for the value starting at `tk`, containers are pushed to the stack
+static
+bool tape_value(TapeBuilder* b, String source, Token tk, U32 key){
+	TapeNode node = { .key = key };
+	JsonValue v = { .source = source, .offset = tk.offset };
+
+	switch(tk.kind){
+		case TK_Nil:   node.kind = TN_Nil;   break;
+		case TK_False: node.kind = TN_False; break;
+		case TK_True:  node.kind = TN_True;  break;
+
+		case TK_Number: {
+			I64 n = 0;
+			F64 f = 0;
+			if(json_get_i64(v, &n)){
+				node.kind = TN_Int;
+				mem_copy_no_overlap(&node.a, &n, sizeof(n));
+			}
+			else if(json_get_f64(v, &f)){
+				node.kind = TN_Float;
+				mem_copy_no_overlap(&node.a, &f, sizeof(f));
+			}
+			else {
+				return false;
+			}
+		} break;
+
+		case TK_String: {
+			String s = {0};
+			if(!json_get_string(v, &s) || !tape_push_bytes(b, s, &node.a)){ return false; }
+			node.kind = TN_String;
+			node.b = s.len;
+		} break;
+
+		case TK_CurlyOpen: case TK_SquareOpen: {
+			if(b->stack.len >= TAPE_MAX_DEPTH){ return false; }
+			node.kind = (tk.kind == TK_CurlyOpen) ? TN_Object : TN_Array;
+			if(!tape_reserve(&b->stack, 1)){ return false; }
+			dyn_array_push(&b->stack, b->nodes.len);
+		} break;
+
+		default:
+			return false;
+	}
+
+	if(!tape_reserve(&b->nodes, 1)){ return false; }
+	dyn_array_push(&b->nodes, node);
+	return true;
+}
+
+bool tape_build(TapeBuilder* b, String source){
+	b->nodes.len = 0;
+	b->keys.len = 0;
+	b->strings.len = 0;
+	b->stack.len = 0;
+	if(!tape_rehash(b, TAPE_MIN_SLOTS)){ return false; }
+
+	Lexer lex = lexer_create(source, NULL);
+	if(!tape_value(b, source, tape_next_token(&lex), TAPE_NO_KEY)){
+		return false;
+	}
+
+	while(b->stack.len > 0){
+		TapeNode* parent = &b->nodes.v[b->stack.v[b->stack.len - 1]];
+		bool object = parent->kind == TN_Object;
+		Token tk = tape_next_token(&lex);
+
+		if(tk.kind == (object ? TK_CurlyClose : TK_SquareClose)){
+			parent->a = b->nodes.len;
+			dyn_array_pop(&b->stack);
+			continue;
+		}
+		if(parent->b > 0){
+			if(tk.kind != TK_Comma){ return false; }
+			tk = tape_next_token(&lex);
+		}
+
+		U32 key = TAPE_NO_KEY;
+		if(object){
+			String name = {0};
+			JsonValue v = { .source = source, .offset = tk.offset };
+			if(tk.kind != TK_String || !json_get_string(v, &name)){ return false; }
+			key = tape_intern(b, name);
+			if(key == TAPE_NO_KEY){ return false; }
+			if(tape_next_token(&lex).kind != TK_Colon){ return false; }
+			tk = tape_next_token(&lex);
+		}
+
+		parent->b += 1; /* Before tape_value, pushing may move the nodes */
+		if(!tape_value(b, source, tk, key)){ return false; }
+	}
+
+	return tape_next_token(&lex).kind == TK_EndOfFile;
+}
+
+static
+TapeHeader tape_header(TapeBuilder const* b){
+	TapeHeader h = {
+		.magic = TAPE_MAGIC,
+		.version = TAPE_VERSION,
+		.node_count = b->nodes.len,
+		.key_count = b->keys.len,
+		.slot_count = b->slots.len,
+		.string_size = b->strings.len,
+	};
+	h.node_offset = sizeof(TapeHeader);
+	h.key_offset = h.node_offset + h.node_count * sizeof(TapeNode);
+	h.slot_offset = h.key_offset + h.key_count * sizeof(TapeKey);
+	h.string_offset = tape_align8(h.slot_offset + h.slot_count * sizeof(U32));
+	h.size = tape_align8(h.string_offset + h.string_size);
+	return h;
+}
+
+Size tape_image_size(TapeBuilder const* b){
+	return tape_header(b).size;
+}
+
+bool tape_write(TapeBuilder const* b, FileWriter* w){
+	static U8 const zeros[8] = {0};
+	TapeHeader h = tape_header(b);
+	Size slot_end = h.slot_offset + h.slot_count * sizeof(U32);
+
+	String parts[] = {
+		str_from_bytes((U8 const*)&h, sizeof(h)),
+		str_from_bytes((U8 const*)b->nodes.v, h.node_count * sizeof(TapeNode)),
+		str_from_bytes((U8 const*)b->keys.v, h.key_count * sizeof(TapeKey)),
+		str_from_bytes((U8 const*)b->slots.v, h.slot_count * sizeof(U32)),
+		str_from_bytes(zeros, h.string_offset - slot_end),
+		str_from_bytes(b->strings.v, h.string_size),
+		str_from_bytes(zeros, h.size - (h.string_offset + h.string_size)),
+	};
+	return file_writer_write_many(w, parts, sizeof(parts) / sizeof(parts[0]));
+}
+
+void tape_image(TapeBuilder const* b, U8* buf){
+	TapeHeader h = tape_header(b);
+	mem_set(buf, 0, h.size);
+	mem_copy_no_overlap(buf, &h, sizeof(h));
+	mem_copy_no_overlap(&buf[h.node_offset], b->nodes.v, h.node_count * sizeof(TapeNode));
+	mem_copy_no_overlap(&buf[h.key_offset], b->keys.v, h.key_count * sizeof(TapeKey));
+	mem_copy_no_overlap(&buf[h.slot_offset], b->slots.v, h.slot_count * sizeof(U32));
+	mem_copy_no_overlap(&buf[h.string_offset], b->strings.v, h.string_size);
+}
+
+// Section [offset, offset + count * elem) fits in `size`
+static inline
+bool tape_section_ok(U64 offset, U64 count, U64 elem, U64 size){
+	return (offset % 8 == 0) && offset <= size && count <= (size - offset) / elem;
+}
+
+bool tape_open(Tape* t, U8 const* data, Size len){
+	if(len < (Size)sizeof(TapeHeader) || ((Uintptr)data & 7) != 0){ return false; }
+
+	TapeHeader const* h = (TapeHeader const*)data;
+	if(h->magic != TAPE_MAGIC || h->version != TAPE_VERSION || h->size > (U64)len){ return false; }
+	if(h->node_count == 0 || h->slot_count == 0 || (h->slot_count & (h->slot_count - 1)) != 0){ return false; }
+	if(!tape_section_ok(h->node_offset, h->node_count, sizeof(TapeNode), h->size) ||
+	   !tape_section_ok(h->key_offset, h->key_count, sizeof(TapeKey), h->size) ||
+	   !tape_section_ok(h->slot_offset, h->slot_count, sizeof(U32), h->size) ||
+	   !tape_section_ok(h->string_offset, h->string_size, 1, h->size)){
+		return false;
+	}
+
+	*t = (Tape){
+		.header = h,
+		.nodes = (TapeNode const*)&data[h->node_offset],
+		.keys = (TapeKey const*)&data[h->key_offset],
+		.slots = (U32 const*)&data[h->slot_offset],
+		.strings = &data[h->string_offset],
+	};
+	return true;
+}
+
+U32 tape_key_id(Tape const* t, String key){
+	U32 hash = tape_hash(key);
+	Size mask = t->header->slot_count - 1;
+	for(Size i = hash & mask, n = 0; n <= mask; i = (i + 1) & mask, n += 1){
+		U32 slot = t->slots[i];
+		if(slot == 0){ break; }
+		TapeKey const* k = &t->keys[slot - 1];
+		if(k->hash == hash && str_eq(str_from_bytes(&t->strings[k->offset], k->len), key)){
+			return slot - 1;
+		}
+	}
+	return TAPE_NO_KEY;
+}
+
+String tape_key(Tape const* t, Size node){
+	U32 id = t->nodes[node].key;
+	if(id == TAPE_NO_KEY){ return (String){0}; }
+	TapeKey const* k = &t->keys[id];
+	return str_from_bytes(&t->strings[k->offset], k->len);
+}
+
+bool tape_find_field_id(Tape const* t, Size obj, U32 key, Size* out){
+	if(tape_kind(t, obj) != TN_Object || key == TAPE_NO_KEY){ return false; }
+	Size end = tape_next(t, obj);
+	for(Size i = obj + 1; i < end; i = tape_next(t, i)){
+		if(t->nodes[i].key == key){
+			*out = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+bool tape_find_field(Tape const* t, Size obj, String key, Size* out){
+	return tape_find_field_id(t, obj, tape_key_id(t, key), out);
+}
+
+bool tape_array_at(Tape const* t, Size arr, Size index, Size* out){
+	if(tape_kind(t, arr) != TN_Array || index < 0 || index >= tape_len(t, arr)){ return false; }
+	Size i = arr + 1;
+	for(Size n = 0; n < index; n += 1){
+		i = tape_next(t, i);
+	}
+	*out = i;
+	return true;
+}
+
+bool tape_get_i64(Tape const* t, Size node, I64* out){
+	if(tape_kind(t, node) != TN_Int){ return false; }
+	mem_copy_no_overlap(out, &t->nodes[node].a, sizeof(*out));
+	return true;
+}
+
+bool tape_get_f64(Tape const* t, Size node, F64* out){
+	I64 n = 0;
+	if(tape_get_i64(t, node, &n)){
+		*out = (F64)n;
+		return true;
+	}
+	if(tape_kind(t, node) != TN_Float){ return false; }
+	mem_copy_no_overlap(out, &t->nodes[node].a, sizeof(*out));
+	return true;
+}
+
+bool tape_get_bool(Tape const* t, Size node, bool* out){
+	U8 kind = tape_kind(t, node);
+	if(kind != TN_True && kind != TN_False){ return false; }
+	*out = kind == TN_True;
+	return true;
+}
+
+bool tape_get_string(Tape const* t, Size node, String* out){
+	TapeNode const* n = &t->nodes[node];
+	if(n->kind != TN_String){ return false; }
+	*out = str_from_bytes(&t->strings[n->a], n->b);
+	return true;
+}
@@ -0,0 +1,166 @@
+#ifndef _tape_h_include_
+#define _tape_h_include_
+
+#include "base/base.h"
+#include "base/strings.h"
+#include "base/allocator.h"
+#include "base/filesystem.h"
+
+// Flat binary encoding of a parsed document. Nodes are stored in document
+// order, containers link to the end of their subtree by index and all other
+// references are offsets from the start of the image, so an image written with
+// tape_write can be mapped back (file_map) and queried in place.
+//
+// Image layout, every section is 8 byte aligned:
+//   TapeHeader | TapeNode[node_count] | TapeKey[key_count] | U32 slots[slot_count] | string data
+//
+// Object keys are interned: a node stores the id of its key and the slots are
+// an open addressing hash table (id + 1, 0 is empty) over the key table, so
+// field lookups compare integers. Strings keep their escapes, like json_get_string.
+// Images are only valid on hosts with the same endianness.
+
+#define TAPE_MAGIC   0x45504154u /* "TAPE" */
+#define TAPE_VERSION 2
+#define TAPE_NO_KEY  0xffffffffu
+
+// Max nesting depth accepted by tape_build
+#define TAPE_MAX_DEPTH 1024
+
+typedef struct TapeHeader TapeHeader;
+typedef struct TapeNode TapeNode;
+typedef struct TapeKey TapeKey;
+typedef struct TapeBuilder TapeBuilder;
+typedef struct Tape Tape;
+
+typedef enum {
+	TN_Nil = 0,
+	TN_False,
+	TN_True,
+	TN_Int,
+	TN_Float,
+	TN_String,
+	TN_Array,
+	TN_Object,
+} TapeNodeKind;
+
+struct TapeHeader {
+	U32 magic;
+	U32 version;
+	U64 size;
+	U64 node_offset;
+	U64 node_count;
+	U64 key_offset;
+	U64 key_count;
+	U64 slot_offset;
+	U64 slot_count; // Power of 2
+	U64 string_offset;
+	U64 string_size;
+};
+
+struct TapeNode {
+	U8  kind;
+	U8  _pad[3];
+	U32 key; // Key id if the node is an object field, TAPE_NO_KEY otherwise
+	U64 a;   // Int/Float: value bits. String: offset into string data. Array/Object: index past the subtree
+	U64 b;   // String: length. Array/Object: number of children
+};
+
+struct TapeKey {
+	U64 offset; // Into string data
+	U32 len;
+	U32 hash;
+};
+
+// Accumulates the sections of an image while parsing
+struct TapeBuilder {
+	struct { TapeNode* v; Size len; Size cap; Allocator allocator; } nodes;
+	struct { TapeKey* v; Size len; Size cap; Allocator allocator; } keys;
+	struct { U32* v; Size len; Size cap; Allocator allocator; } slots;
+	struct { U8* v; Size len; Size cap; Allocator allocator; } strings;
+	struct { Size* v; Size len; Size cap; Allocator allocator; } stack;
+};
+
+// Read-only view over an image
+struct Tape {
+	TapeHeader const* header;
+	TapeNode const* nodes;
+	TapeKey const* keys;
+	U32 const* slots;
+	U8 const* strings;
+};
+
+// Initialize builder, all sections grow with `allocator`
+void tape_builder_init(TapeBuilder* b, Allocator allocator);
+
+// Free the builder's sections
+void tape_builder_destroy(TapeBuilder* b);
+
+// Parse `source` into the builder, replacing its previous content. Returns
+// false on malformed input or allocation failure
+bool tape_build(TapeBuilder* b, String source);
+
+// Size of the image tape_write/tape_image would produce
+Size tape_image_size(TapeBuilder const* b);
+
+// Write image to `w` without concatenating sections first, returns false on failure
+bool tape_write(TapeBuilder const* b, FileWriter* w);
+
+// Copy image into `buf`, which must be 8 byte aligned and tape_image_size(b) long
+void tape_image(TapeBuilder const* b, U8* buf);
+
+// Open an image, checks the header and section bounds but not the nodes, so
+// only images written by tape_write should be opened. `data` must stay valid
+// while the tape is in use. Returns false on invalid images
+bool tape_open(Tape* t, U8 const* data, Size len);
+
+// Index of the root node
+static inline
+Size tape_root(Tape const* t){
+	(void)t;
+	return 0;
+}
+
+static inline
+U8 tape_kind(Tape const* t, Size node){
+	return t->nodes[node].kind;
+}
+
+// Index past the node and its subtree, i.e. its next sibling if it has one
+static inline
+Size tape_next(Tape const* t, Size node){
+	TapeNode const* n = &t->nodes[node];
+	return (n->kind == TN_Array || n->kind == TN_Object) ? (Size)n->a : node + 1;
+}
+
+// Number of children of an array or object
+static inline
+Size tape_len(Tape const* t, Size node){
+	TapeNode const* n = &t->nodes[node];
+	return (n->kind == TN_Array || n->kind == TN_Object) ? (Size)n->b : 0;
+}
+
+// Interned id of `key`, TAPE_NO_KEY if no object in the image has it
+U32 tape_key_id(Tape const* t, String key);
+
+// Key of an object field
+String tape_key(Tape const* t, Size node);
+
+// Find field by key id, children are scanned comparing ids only
+bool tape_find_field_id(Tape const* t, Size obj, U32 key, Size* out);
+
+// Find field `key` of an object
+bool tape_find_field(Tape const* t, Size obj, String key, Size* out);
+
+// Get i-th array element
+bool tape_array_at(Tape const* t, Size arr, Size index, Size* out);
+
+bool tape_get_i64(Tape const* t, Size node, I64* out);
+
+// Ints are converted
+bool tape_get_f64(Tape const* t, Size node, F64* out);
+
+bool tape_get_bool(Tape const* t, Size node, bool* out);
+
+bool tape_get_string(Tape const* t, Size node, String* out);
+
+#endif /* Include guard */